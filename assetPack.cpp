@@ -0,0 +1,272 @@
+#include "common.cpp"
+#include "assetPack.h"
+#include "vkMemory.h"
+#include "image.h"
+#include "commands.h"
+#include "compressedTexture.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <lz4.h>
+
+AssetPack::AssetPack(AssetPack &&other)
+{
+    *this = std::move(other);
+}
+
+AssetPack &AssetPack::operator=(AssetPack &&other)
+{
+    if (this != &other)
+    {
+        close();
+        logicalDevice = other.logicalDevice;
+        physicalDevice = other.physicalDevice;
+        commandPools = other.commandPools;
+        queues = other.queues;
+        mapping = other.mapping;
+        mappingSize = other.mappingSize;
+        entries = std::move(other.entries);
+        other.mapping = nullptr;
+        other.mappingSize = 0;
+        other.entries.clear();
+    }
+    return *this;
+}
+
+void AssetPack::open(std::string path, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, CommandPools *commandPools, VkQueues queues)
+{
+    this->logicalDevice = logicalDevice;
+    this->physicalDevice = physicalDevice;
+    this->commandPools = commandPools;
+    this->queues = queues;
+
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        throw std::runtime_error("failed to open asset pack " + path);
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(PackHeader))
+    {
+        ::close(file);
+        throw std::runtime_error("invalid asset pack size in " + path);
+    }
+    mappingSize = static_cast<size_t>(info.st_size);
+    void *data = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error("failed to map asset pack " + path);
+    }
+    mapping = static_cast<const uint8_t *>(data);
+
+    auto header = reinterpret_cast<const PackHeader *>(mapping);
+    // written as subtractions, so huge offsets and counts can't wrap around
+    if (header->magic != PACK_MAGIC || header->version != PACK_VERSION || header->indexOffset > mappingSize || header->entryCount > (mappingSize - header->indexOffset) / sizeof(PackEntry))
+    {
+        close();
+        throw std::runtime_error("not a valid asset pack: " + path);
+    }
+    auto index = reinterpret_cast<const PackEntry *>(mapping + header->indexOffset);
+    for (uint32_t i = 0; i < header->entryCount; i++)
+    {
+        // uncompressed payloads are copied rawSize bytes straight out of the mapping, buffers are divided by elementSize
+        auto &entry = index[i];
+        bool uncompressedMismatch = entry.compression == PACK_UNCOMPRESSED && entry.rawSize != entry.size;
+        bool noElementSize = (entry.type == PACK_VERTICES || entry.type == PACK_INDICES) && entry.elementSize == 0;
+        if (entry.offset > mappingSize || entry.size > mappingSize - entry.offset || entry.mipLevels > PACK_MAX_LEVELS || uncompressedMismatch || noElementSize)
+        {
+            close();
+            throw std::runtime_error("corrupt asset pack entry in " + path);
+        }
+        entries[std::string(index[i].name, strnlen(index[i].name, sizeof(index[i].name)))] = &index[i];
+    }
+}
+
+bool AssetPack::contains(std::string name)
+{
+    return entries.find(name) != entries.end();
+}
+
+const PackEntry &AssetPack::find(std::string name, uint32_t type)
+{
+    auto entry = entries.find(name);
+    if (entry == entries.end() || entry->second->type != type)
+    {
+        throw std::runtime_error("asset pack has no such entry: " + name);
+    }
+    return *entry->second;
+}
+
+// copies or decompresses the payload into destination, which holds rawSize bytes
+void AssetPack::unpack(const PackEntry &entry, void *destination)
+{
+    auto source = reinterpret_cast<const char *>(mapping + entry.offset);
+    if (entry.compression == PACK_UNCOMPRESSED)
+    {
+        memcpy(destination, source, static_cast<size_t>(entry.rawSize));
+        return;
+    }
+    if (entry.compression != PACK_LZ4 || LZ4_decompress_safe(source, static_cast<char *>(destination), static_cast<int>(entry.size), static_cast<int>(entry.rawSize)) != static_cast<int>(entry.rawSize))
+    {
+        throw std::runtime_error("failed to decompress asset pack entry!");
+    }
+}
+
+// host visible buffer holding the decompressed payload
+Buffer AssetPack::stage(const PackEntry &entry)
+{
+    auto stagingBuffer = createBuffer(entry.rawSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+    void *data;
+    vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, entry.rawSize, 0, &data);
+    try
+    {
+        unpack(entry, data);
+    }
+    catch (...)
+    {
+        vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
+        vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
+        vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
+        throw;
+    }
+    vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
+    return stagingBuffer;
+}
+
+// bytes of one level of a texture entry, packs store RGBA8 or the formats loadCompressedImage reads
+static VkDeviceSize packLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    if (format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_R8G8B8A8_UNORM)
+    {
+        return static_cast<VkDeviceSize>(width) * height * 4;
+    }
+    return levelSize(format, width, height);
+}
+
+// texel data is stored in its final format with all mip levels, it is only decoded when the device cannot sample
+// the block compressed format
+Texture AssetPack::loadTexture(std::string name)
+{
+    auto &entry = find(name, PACK_TEXTURE);
+    VkFormat format = static_cast<VkFormat>(entry.format);
+    if (entry.mipLevels == 0 || entry.width == 0 || entry.height == 0)
+    {
+        throw std::runtime_error("failed to load texture " + name + ", the asset pack entry has no texels!");
+    }
+    for (uint32_t i = 0; i < entry.mipLevels; i++)
+    {
+        auto size = packLevelSize(format, std::max(entry.width >> i, 1u), std::max(entry.height >> i, 1u));
+        if (entry.levelOffsets[i] > entry.rawSize || size > entry.rawSize - entry.levelOffsets[i])
+        {
+            throw std::runtime_error("failed to load texture " + name + ", mip level " + std::to_string(i) + " lies outside the asset pack entry!");
+        }
+    }
+
+    std::vector<VkDeviceSize> levelOffsets(entry.levelOffsets, entry.levelOffsets + entry.mipLevels);
+    Buffer stagingBuffer;
+    if (checkSampledSupport(format, physicalDevice))
+    {
+        stagingBuffer = stage(entry);
+    }
+    else
+    {
+        CompressedImage image;
+        image.format = format;
+        image.width = entry.width;
+        image.height = entry.height;
+        image.data.resize(static_cast<size_t>(entry.rawSize));
+        image.levelOffsets = levelOffsets;
+        unpack(entry, image.data.data());
+        image = transcodeImage(image);
+        format = image.format;
+        levelOffsets = image.levelOffsets;
+
+        VkDeviceSize imageSize = image.data.size();
+        stagingBuffer = createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+        void *data;
+        vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, imageSize, 0, &data);
+        memcpy(data, image.data.data(), static_cast<size_t>(imageSize));
+        vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
+    }
+
+    Texture texture;
+    texture.format = format;
+    texture.mipLevels = entry.mipLevels;
+    std::vector<VkBufferImageCopy> regions;
+    for (uint32_t i = 0; i < entry.mipLevels; i++)
+    {
+        regions.push_back(mipCopyRegion(levelOffsets[i], i, std::max(entry.width >> i, 1u), std::max(entry.height >> i, 1u)));
+    }
+    createImage(entry.width, entry.height, entry.mipLevels, texture.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.textureImage, texture.textureImageMemory, logicalDevice, physicalDevice);
+    transitionImageLayout(texture.textureImage, texture.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, entry.mipLevels, logicalDevice, commandPools->current(), queues);
+    copyBufferToImage(stagingBuffer.buffer, texture.textureImage, regions, logicalDevice, commandPools->current(), queues);
+    transitionImageLayout(texture.textureImage, texture.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, entry.mipLevels, logicalDevice, commandPools->current(), queues);
+    vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
+    vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
+
+    texture.imageView = createTextureImageView(texture, logicalDevice);
+    return texture;
+}
+
+Buffer AssetPack::loadBuffer(std::string name, uint32_t type, VkBufferUsageFlags usage)
+{
+    auto &entry = find(name, type);
+    auto stagingBuffer = stage(entry);
+    auto buffer = createBuffer(entry.rawSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, logicalDevice, physicalDevice);
+    buffer.amountElements = static_cast<int>(entry.rawSize / entry.elementSize);
+    copyBuffer(stagingBuffer.buffer, buffer.buffer, entry.rawSize, logicalDevice, commandPools->current(), queues);
+    vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
+    vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
+    return buffer;
+}
+
+Buffer AssetPack::loadVertexBuffer(std::string name)
+{
+    return loadBuffer(name, PACK_VERTICES, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+}
+
+Buffer AssetPack::loadIndexBuffer(std::string name)
+{
+    auto buffer = loadBuffer(name, PACK_INDICES, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    buffer.indexType = find(name, PACK_INDICES).elementSize == sizeof(uint32_t) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+    return buffer;
+}
+
+// uncompressed SPIR-V is handed to the driver straight from the mapping
+VkShaderModule AssetPack::loadShader(std::string name)
+{
+    auto &entry = find(name, PACK_SHADER);
+    std::vector<uint32_t> decompressed;
+    const uint32_t *code = reinterpret_cast<const uint32_t *>(mapping + entry.offset);
+    if (entry.compression != PACK_UNCOMPRESSED)
+    {
+        decompressed.resize((entry.rawSize + 3) / 4);
+        unpack(entry, decompressed.data());
+        code = decompressed.data();
+    }
+
+    VkShaderModuleCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.codeSize = entry.rawSize;
+    info.pCode = code;
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(logicalDevice, &info, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed shader module creation");
+    }
+    return shaderModule;
+}
+
+void AssetPack::close()
+{
+    if (mapping != nullptr)
+    {
+        munmap(const_cast<uint8_t *>(mapping), mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    entries.clear();
+}
\ No newline at end of file
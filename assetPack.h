@@ -0,0 +1,42 @@
+#ifndef asset_pack_h
+#define asset_pack_h
+
+#include "common.cpp"
+#include "commandPools.h"
+
+// read only view of a memory mapped asset pack written by tools/packAssets.cpp,
+// payloads go from the mapping straight into staging memory
+class AssetPack
+{
+public:
+    AssetPack() = default;
+    // the mapping is owned by one pack at a time, moving hands it over
+    AssetPack(const AssetPack &) = delete;
+    AssetPack &operator=(const AssetPack &) = delete;
+    AssetPack(AssetPack &&other);
+    AssetPack &operator=(AssetPack &&other);
+
+    void open(std::string path, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, CommandPools *commandPools, VkQueues queues);
+    bool contains(std::string name);
+    Texture loadTexture(std::string name);
+    Buffer loadVertexBuffer(std::string name);
+    Buffer loadIndexBuffer(std::string name);
+    VkShaderModule loadShader(std::string name);
+    void close();
+
+private:
+    VkDevice logicalDevice;
+    VkPhysicalDevice physicalDevice;
+    CommandPools *commandPools;
+    VkQueues queues;
+    const uint8_t *mapping = nullptr;
+    size_t mappingSize = 0;
+    std::unordered_map<std::string, const PackEntry *> entries;
+
+    const PackEntry &find(std::string name, uint32_t type);
+    void unpack(const PackEntry &entry, void *destination);
+    Buffer stage(const PackEntry &entry);
+    Buffer loadBuffer(std::string name, uint32_t type, VkBufferUsageFlags usage);
+};
+
+#endif
\ No newline at end of file
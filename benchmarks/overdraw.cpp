@@ -0,0 +1,99 @@
+#include "../common.cpp"
+#include "../image.h"
+#include "../vesuv.h"
+#include "../vertex.h"
+#include "../vertexData.h"
+
+// stacks LAYERS screen filling quads and compares fragment shader invocations
+// of back to front submission against the front to back sorted order
+const int LAYERS = 32;
+const int FRAMES = 300;
+
+uint64_t measure(Vesuv &vesuv, std::vector<DrawCommand> &draws, std::vector<Uniforms> &uniforms, bool sorted)
+{
+    vesuv.sortDraws = sorted;
+    uint64_t invocations = 0;
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        for (int i = 0; i < LAYERS; i++)
+        {
+            draws[i].descriptorSet = uniforms[i].descriptorSets[vesuv.currentFrame];
+        }
+        vesuv.drawFrame(draws);
+        glfwPollEvents();
+        // the first frames report results of the previous run
+        if (frame >= vesuv.MAX_FRAMES_IN_FLIGHT)
+        {
+            invocations += vesuv.fragmentInvocations;
+        }
+    }
+    vkDeviceWaitIdle(vesuv.logicalDevice);
+    return invocations / (FRAMES - vesuv.MAX_FRAMES_IN_FLIGHT);
+}
+
+int main()
+{
+    VesuvSettings settings;
+    settings.depthBuffer = true;
+    settings.pipelineStatistics = true;
+    Vesuv vesuv(settings);
+    if (vesuv.statisticsQueries == VK_NULL_HANDLE)
+    {
+        printf("device does not support pipeline statistics queries\n");
+        vesuv.cleanup();
+        return 1;
+    }
+
+    auto texture = vesuv.createTexture("statue");
+    auto sampler = createTextureSampler(vesuv.physicalDevice, vesuv.logicalDevice);
+    auto vertexBuffer = vesuv.createVBO(quadVertices);
+    auto indexBuffer = vesuv.createIndexBuffer(quadIndices);
+
+    std::vector<Uniforms> uniforms;
+    std::vector<DrawCommand> draws(LAYERS);
+    GraphicsPipeline pipeline;
+    for (int i = 0; i < LAYERS; i++)
+    {
+        uniforms.push_back(vesuv.createUniforms(std::vector<VkDescriptorType>{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER}, 1, texture, sampler));
+        if (i == 0)
+        {
+            pipeline = vesuv.createGraphicPipeline(uniforms[0].descriptorSetLayout, "tri");
+        }
+        // farthest layer first, the submission order the unsorted run records
+        float depth = 1.0f - (i + 1) / (float)(LAYERS + 1);
+        UniformBufferObject ubo{};
+        ubo.model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, depth)) * glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 2.0f, 1.0f));
+        ubo.view = glm::mat4(1.0f);
+        ubo.proj = glm::mat4(1.0f);
+        for (auto &buffer : uniforms[i].uniformBuffers)
+        {
+            memcpy(buffer.memMap, &ubo, sizeof(ubo));
+        }
+        draws[i].pipeline = pipeline.pipeline;
+        draws[i].layout = pipeline.layout;
+        draws[i].vertexBuffer = vertexBuffer;
+        draws[i].indexBuffer = indexBuffer;
+        draws[i].depth = depth;
+    }
+
+    auto unsorted = measure(vesuv, draws, uniforms, false);
+    auto sorted = measure(vesuv, draws, uniforms, true);
+    printf("%d layers, fragment shader invocations per frame\n", LAYERS);
+    printf("back to front: %llu\n", (unsigned long long)unsorted);
+    printf("front to back: %llu\n", (unsigned long long)sorted);
+    if (unsorted > 0)
+    {
+        printf("saved: %.1f%%\n", 100.0 * (1.0 - sorted / (double)unsorted));
+    }
+
+    for (auto &uniform : uniforms)
+    {
+        vesuv.destroyUniforms(uniform);
+    }
+    vesuv.destroyPipeline(pipeline);
+    vesuv.destroyBuffer(indexBuffer);
+    vesuv.destroyBuffer(vertexBuffer);
+    vesuv.destroySampler(sampler);
+    vesuv.destroyTexture(texture);
+    vesuv.cleanup();
+}
@@ -0,0 +1,136 @@
+#include "../common.cpp"
+#include "../spatialIndex.h"
+
+// moves OBJECTS rectangles around a square world every frame, then queries a screen sized view, both as a
+// rectangle and as an orthographic frustum, and picks PICKS points; queries are compared against a linear scan
+const uint32_t OBJECTS = 1000000;
+const int FRAMES = 60;
+const int PICKS = 1000;
+const float WORLD = 100000.0f;
+
+struct Object
+{
+    glm::vec2 position;
+    glm::vec2 velocity;
+    glm::vec2 size;
+};
+
+static uint32_t state = 12345;
+
+float randomFloat()
+{
+    state = state * 1664525u + 1013904223u;
+    return static_cast<float>(state >> 8) / 16777216.0f;
+}
+
+glm::vec4 rectOf(const Object &object)
+{
+    return glm::vec4(object.position.x, object.position.y, object.position.x + object.size.x, object.position.y + object.size.y);
+}
+
+double millisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+size_t scan(const std::vector<Object> &objects, glm::vec4 rect)
+{
+    size_t found = 0;
+    for (auto &object : objects)
+    {
+        auto bounds = rectOf(object);
+        found += bounds.x <= rect.z && bounds.z >= rect.x && bounds.y <= rect.w && bounds.w >= rect.y ? 1 : 0;
+    }
+    return found;
+}
+
+// maps view to [-1, 1] like glm::ortho, without pulling in the matrix extension
+glm::mat4 orthographic(glm::vec4 view)
+{
+    glm::mat4 projection(1.0f);
+    projection[0][0] = 2.0f / (view.z - view.x);
+    projection[1][1] = 2.0f / (view.w - view.y);
+    projection[3][0] = -(view.z + view.x) / (view.z - view.x);
+    projection[3][1] = -(view.w + view.y) / (view.w - view.y);
+    return projection;
+}
+
+int main()
+{
+    std::vector<Object> objects(OBJECTS);
+    for (auto &object : objects)
+    {
+        object.position = glm::vec2(randomFloat() * WORLD, randomFloat() * WORLD);
+        object.velocity = glm::vec2(randomFloat() * 20.0f - 10.0f, randomFloat() * 20.0f - 10.0f);
+        object.size = glm::vec2(4.0f + randomFloat() * 60.0f, 4.0f + randomFloat() * 60.0f);
+    }
+
+    SpatialIndex index;
+    index.init(glm::vec4(0.0f, 0.0f, WORLD, WORLD), 10);
+    std::vector<uint32_t> ids(OBJECTS);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < OBJECTS; i++)
+    {
+        ids[i] = index.insert(rectOf(objects[i]));
+    }
+    printf("insert %u objects: %.2f ms\n", OBJECTS, millisecondsSince(start));
+
+    double moveTime = 0, rectTime = 0, frustumTime = 0, pickTime = 0, scanTime = 0;
+    size_t rectFound = 0, frustumFound = 0, picked = 0, scanFound = 0;
+    std::vector<uint32_t> results;
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        start = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < OBJECTS; i++)
+        {
+            auto &object = objects[i];
+            object.position += object.velocity;
+            if (object.position.x < 0.0f || object.position.x > WORLD)
+            {
+                object.velocity.x = -object.velocity.x;
+            }
+            if (object.position.y < 0.0f || object.position.y > WORLD)
+            {
+                object.velocity.y = -object.velocity.y;
+            }
+            index.move(ids[i], rectOf(object));
+        }
+        moveTime += millisecondsSince(start);
+
+        glm::vec2 corner(randomFloat() * (WORLD - 1920.0f), randomFloat() * (WORLD - 1080.0f));
+        glm::vec4 view(corner.x, corner.y, corner.x + 1920.0f, corner.y + 1080.0f);
+
+        results.clear();
+        start = std::chrono::high_resolution_clock::now();
+        index.queryRect(view, results);
+        rectTime += millisecondsSince(start);
+        rectFound += results.size();
+
+        results.clear();
+        start = std::chrono::high_resolution_clock::now();
+        index.queryFrustum(orthographic(view), results);
+        frustumTime += millisecondsSince(start);
+        frustumFound += results.size();
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < PICKS; i++)
+        {
+            results.clear();
+            index.queryPoint(glm::vec2(randomFloat() * WORLD, randomFloat() * WORLD), results);
+            picked += results.size();
+        }
+        pickTime += millisecondsSince(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        scanFound += scan(objects, view);
+        scanTime += millisecondsSince(start);
+    }
+
+    printf("per frame, %d frames:\n", FRAMES);
+    printf("  move all:       %8.3f ms\n", moveTime / FRAMES);
+    printf("  rect query:     %8.3f ms, %zu objects\n", rectTime / FRAMES, rectFound / FRAMES);
+    printf("  frustum query:  %8.3f ms, %zu objects\n", frustumTime / FRAMES, frustumFound / FRAMES);
+    printf("  %d picks:     %8.3f ms, %.2f objects each\n", PICKS, pickTime / FRAMES, static_cast<double>(picked) / (FRAMES * PICKS));
+    printf("  linear scan:    %8.3f ms, %zu objects\n", scanTime / FRAMES, scanFound / FRAMES);
+    return rectFound == scanFound && frustumFound == scanFound ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "common.cpp"
+#include "bindless.h"
+
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+void BindlessTextures::init(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkSampler sampler, uint32_t framesInFlight)
+{
+    this->logicalDevice = logicalDevice;
+    this->sampler = sampler;
+    retiredIndices.resize(framesInFlight);
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+    // combined image samplers count against both the sampled image and the sampler limits
+    capacity = std::min({MAX_BINDLESS_TEXTURES,
+                         indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                         indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                         indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+                         indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = capacity;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // unused slots may stay empty and slots can be written while the set is bound in a pending frame
+    VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = 1;
+    bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bindless descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = capacity;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create bindless descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &set) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+    }
+}
+
+uint32_t BindlessTextures::add(VkImageView view)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t index;
+    if (!freeIndices.empty())
+    {
+        index = freeIndices.back();
+        freeIndices.pop_back();
+    }
+    else if (nextIndex < capacity)
+    {
+        index = nextIndex++;
+    }
+    else
+    {
+        throw std::runtime_error("bindless texture table is full!");
+    }
+    write(index, view);
+    return index;
+}
+
+void BindlessTextures::update(uint32_t index, VkImageView view)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    write(index, view);
+}
+
+void BindlessTextures::write(uint32_t index, VkImageView view)
+{
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = view;
+    imageInfo.sampler = sampler;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = 0;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(logicalDevice, 1, &write, 0, nullptr);
+}
+
+// the slot is left as is (partially bound), frames already recorded may still sample it
+void BindlessTextures::remove(uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    removedIndices.push_back(index);
+}
+
+// what was retired with this frame was removed before the frame was recorded, so every frame using it is done now;
+// what was removed since goes with this frame and is free the next time it comes around
+void BindlessTextures::recycle(uint32_t frame)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &retired = retiredIndices[frame];
+    freeIndices.insert(freeIndices.end(), retired.begin(), retired.end());
+    retired.clear();
+    retired.swap(removedIndices);
+}
+
+void BindlessTextures::destroy()
+{
+    vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
+    vkDestroyDescriptorSetLayout(logicalDevice, layout, nullptr);
+}
@@ -0,0 +1,39 @@
+#ifndef bindless_h
+#define bindless_h
+
+#include "common.cpp"
+
+// one global, partially bound, update-after-bind array of combined image samplers indexed from shaders;
+// add, update and remove may be called from any thread
+class BindlessTextures
+{
+public:
+    VkDescriptorSetLayout layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+    VkSampler sampler;
+    uint32_t capacity;
+
+    void init(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkSampler sampler, uint32_t framesInFlight);
+    uint32_t add(VkImageView view);
+    void update(uint32_t index, VkImageView view);
+    // the index is handed out again once every frame that may still sample it is done
+    void remove(uint32_t index);
+    // call once the frame's fence signaled, before the frame is recorded again
+    void recycle(uint32_t frame);
+    void destroy();
+
+private:
+    VkDevice logicalDevice;
+    uint32_t nextIndex = 0;
+    std::vector<uint32_t> freeIndices;
+    // removed since the last recycle, and per frame the indices that become free when it comes around again
+    std::vector<uint32_t> removedIndices;
+    std::vector<std::vector<uint32_t>> retiredIndices;
+    // guards the indices and writes to set, which Vulkan requires to be externally synchronized
+    std::mutex mutex;
+
+    void write(uint32_t index, VkImageView view);
+};
+
+#endif
@@ -0,0 +1,39 @@
+#include "common.cpp"
+#include "commandPools.h"
+
+void CommandPools::init(VkDevice logicalDevice, uint32_t queueFamily)
+{
+    this->logicalDevice = logicalDevice;
+    this->queueFamily = queueFamily;
+}
+
+VkCommandPool CommandPools::current()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = pools.find(std::this_thread::get_id());
+    if (found != pools.end())
+    {
+        return found->second;
+    }
+    VkCommandPoolCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    info.queueFamilyIndex = queueFamily;
+    VkCommandPool pool;
+    if (vkCreateCommandPool(logicalDevice, &info, nullptr, &pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create command pool!");
+    }
+    pools[std::this_thread::get_id()] = pool;
+    return pool;
+}
+
+void CommandPools::destroy()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &pool : pools)
+    {
+        vkDestroyCommandPool(logicalDevice, pool.second, nullptr);
+    }
+    pools.clear();
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef command_pools_h
+#define command_pools_h
+
+#include "common.cpp"
+
+// a transient command pool per thread for single time commands, command pools must not be used by two threads at once
+class CommandPools
+{
+public:
+    void init(VkDevice logicalDevice, uint32_t queueFamily);
+    // the calling thread's pool, created on its first call
+    VkCommandPool current();
+    // every thread that used its pool must be done with it
+    void destroy();
+
+private:
+    VkDevice logicalDevice;
+    uint32_t queueFamily;
+    std::mutex mutex;
+    std::unordered_map<std::thread::id, VkCommandPool> pools;
+};
+
+#endif
\ No newline at end of file
@@ -1,12 +1,13 @@
 #include "common.cpp"
 #include "device.h"
+#include "computePipeline.h"
 
-VkCommandPool createCommandPool(QueueFamilyIndices queueIndices, VkDevice logicalDevice)
+VkCommandPool createCommandPool(uint32_t queueFamily, VkDevice logicalDevice)
 {
     VkCommandPoolCreateInfo info{};
     info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    info.queueFamilyIndex = queueIndices.graphicsFamily.value();
+    info.queueFamilyIndex = queueFamily;
     VkCommandPool retPool;
     if (vkCreateCommandPool(logicalDevice, &info, nullptr, &retPool) != VK_SUCCESS)
     {
@@ -15,6 +16,31 @@ VkCommandPool createCommandPool(QueueFamilyIndices queueIndices, VkDevice logica
     return retPool;
 }
 
+VkCommandPool createCommandPool(QueueFamilyIndices queueIndices, VkDevice logicalDevice)
+{
+    return createCommandPool(queueIndices.graphicsFamily.value(), logicalDevice);
+}
+
+VkResult queueSubmit(VkQueues queues, VkQueue queue, const VkSubmitInfo &submitInfo, VkFence fence)
+{
+    if (queues.submitMutex == nullptr)
+    {
+        return vkQueueSubmit(queue, 1, &submitInfo, fence);
+    }
+    std::lock_guard<std::mutex> lock(*queues.submitMutex);
+    return vkQueueSubmit(queue, 1, &submitInfo, fence);
+}
+
+VkResult queuePresent(VkQueues queues, const VkPresentInfoKHR &presentInfo)
+{
+    if (queues.submitMutex == nullptr)
+    {
+        return vkQueuePresentKHR(queues.presentationQueue, &presentInfo);
+    }
+    std::lock_guard<std::mutex> lock(*queues.submitMutex);
+    return vkQueuePresentKHR(queues.presentationQueue, &presentInfo);
+}
+
 VkCommandBuffer beginSingleTimeCommands(VkDevice logicalDevice, VkCommandPool commandPool)
 {
     VkCommandBufferAllocateInfo allocInfo{};
@@ -44,8 +70,20 @@ void endSingleTimeCommands(VkCommandBuffer commandBuffer, VkQueues queues, VkDev
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(queues.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(queues.graphicsQueue);
+    // waits for its own fence instead of the whole queue, so other threads can keep submitting meanwhile
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create fence!");
+    }
+    if (queueSubmit(queues, queues.graphicsQueue, submitInfo, fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit single time commands!");
+    }
+    vkWaitForFences(logicalDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+    vkDestroyFence(logicalDevice, fence, nullptr);
 
     vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
 }
@@ -66,82 +104,223 @@ std::vector<VkCommandBuffer> createCommandBuffers(int size, VkCommandPool pool,
     return buffers;
 }
 
+// one fragment shader invocation counter per query
+VkQueryPool createStatisticsQueryPool(int size, VkDevice logicalDevice)
+{
+    VkQueryPoolCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    info.queryCount = size;
+    info.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    VkQueryPool queryPool;
+    if (vkCreateQueryPool(logicalDevice, &info, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create query pool!");
+    }
+    return queryPool;
+}
+
+// one boolean occlusion query per object, reset at the start of every frame that uses the pool
+VkQueryPool createOcclusionQueryPool(uint32_t size, VkDevice logicalDevice)
+{
+    VkQueryPoolCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_OCCLUSION;
+    info.queryCount = size;
+    VkQueryPool queryPool;
+    if (vkCreateQueryPool(logicalDevice, &info, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create query pool!");
+    }
+    return queryPool;
+}
+
+// opaque draws front to back so early depth testing rejects hidden fragments before shading,
+// then transparent draws back to front for correct blending; opaque draws at equal depth are grouped by pipeline,
+// transparent ones keep the order they were passed in since that is their blend order (e.g. SpriteBatch runs)
+void sortDrawCommands(std::vector<DrawCommand> &draws)
+{
+    std::stable_sort(draws.begin(), draws.end(), [](const DrawCommand &a, const DrawCommand &b)
+                     {
+                         if (a.opaque != b.opaque)
+                         {
+                             return a.opaque;
+                         }
+                         if (a.depth != b.depth)
+                         {
+                             return a.opaque ? a.depth < b.depth : a.depth > b.depth;
+                         }
+                         return a.opaque && a.pipeline < b.pipeline; });
+}
+
 int max(int a, int b)
 {
     return a > b ? a : b;
 }
 
-void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, GraphicsPipeline graphicsPipeline, SwapChain swapchain, VkRenderPass renderPass, std::vector<Uniforms> uniforms, int currentFrame, std::vector<Buffer> vertexBuffer, std::vector<Buffer> indexBuffer)
+// indirect draws are left out, their counts are only known on the GPU
+void countTriangles(const std::vector<DrawCommand> &draws, uint64_t &submitted, uint64_t &fullDetail)
 {
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    submitted = 0;
+    fullDetail = 0;
+    for (auto &draw : draws)
     {
-        throw std::runtime_error("failed to begin recording command buffer!");
+        if (draw.occluded || draw.maxDrawCount != 0)
+        {
+            continue;
+        }
+        uint32_t vertices = draw.indexCount != 0 ? draw.indexCount : draw.indexBuffer.amountElements != 0 ? draw.indexBuffer.amountElements
+                                                                                                          : draw.vertexBuffer.amountElements;
+        submitted += vertices / 3;
+        fullDetail += (draw.fullDetailIndices != 0 ? draw.fullDetailIndices : vertices) / 3;
     }
+}
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = swapchain.framebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = swapchain.extent;
-    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipeline);
-
-    // VkBuffer vertexBuffers[] = {vertexBuffer.buffer};
-    // VkDeviceSize offsets[] = {0};
-    // vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-    // vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
-    // vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.layout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+// records the draws into the render pass that is currently begun, occlusion proxies are only drawn with a query pool
+void recordDraws(VkCommandBuffer commandBuffer, VkExtent2D extent, const std::vector<DrawCommand> &draws, VkDescriptorSet textureSet, VkQueryPool occlusionQueries)
+{
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-    /* vkCmdDraw(commandBuffer, 6, 1, 0, 0);
-        VkBuffer vertexBuffers2[] = {vertexBuffer2.buffer};
-        VkDeviceSize offsets2[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers2, offsets2);
-        vkCmdDraw(commandBuffer, 6, 1, 0, 0); */
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-    for (int i = 0; i < vertexBuffer.size(); i++)
+    // only rebind what changed, sets stay bound across pipelines that share a pipeline layout
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+    VkDescriptorSet boundSet = VK_NULL_HANDLE;
+    bool textureSetBound = false;
+    for (auto &draw : draws)
     {
+        // the proxy pipeline shares the object's pipeline layout, so the sets bound below serve both
+        bool proxy = occlusionQueries != VK_NULL_HANDLE && draw.occlusionQuery != NO_QUERY;
+        VkPipeline pipeline = proxy ? draw.proxyPipeline : draw.pipeline;
+        if (pipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
+        if (draw.layout != boundLayout)
+        {
+            boundLayout = draw.layout;
+            boundSet = VK_NULL_HANDLE;
+            textureSetBound = false;
+        }
+        if (draw.descriptorSet != VK_NULL_HANDLE && draw.descriptorSet != boundSet)
+        {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.layout, 0, 1, &draw.descriptorSet, 0, nullptr);
+            boundSet = draw.descriptorSet;
+        }
+        if (draw.textureIndex != NO_TEXTURE)
+        {
+            // the texture table is set 1 of every bindless pipeline layout
+            if (!textureSetBound)
+            {
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.layout, 1, 1, &textureSet, 0, nullptr);
+                textureSetBound = true;
+            }
+            vkCmdPushConstants(commandBuffer, draw.layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &draw.textureIndex);
+        }
 
-        // auto drawIndexed = indexBuffer[i].bufferMemory == nullptr;
-        VkBuffer vertexBuffers[] = {vertexBuffer[i].buffer};
         VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-        if (uniforms[i].amountSetElements != 0)
+        if (proxy)
         {
-            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.layout, 0, 1, &uniforms[i].descriptorSets[currentFrame], 0, nullptr);
+            // tested against the depth of everything drawn before, the result decides about a later frame
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &draw.proxyVertexBuffer.buffer, offsets);
+            vkCmdBeginQuery(commandBuffer, occlusionQueries, draw.occlusionQuery, 0);
+            vkCmdDraw(commandBuffer, draw.proxyVertexBuffer.amountElements, 1, 0, 0);
+            vkCmdEndQuery(commandBuffer, occlusionQueries, draw.occlusionQuery);
+            if (draw.occluded)
+            {
+                continue;
+            }
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+            boundPipeline = draw.pipeline;
         }
 
-        if (indexBuffer[i].amountElements != 0)
+        VkBuffer vertexBuffers[] = {draw.vertexBuffer.buffer};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+        if (draw.maxDrawCount != 0)
         {
-            vkCmdBindIndexBuffer(commandBuffer, indexBuffer[i].buffer, 0, VK_INDEX_TYPE_UINT16);
-            vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indexBuffer[i].amountElements), 1, 0, 0, 0);
+            vkCmdBindIndexBuffer(commandBuffer, draw.indexBuffer.buffer, 0, draw.indexBuffer.indexType);
+            if (draw.countBuffer.buffer != VK_NULL_HANDLE)
+            {
+                vkCmdDrawIndexedIndirectCount(commandBuffer, draw.indirectBuffer.buffer, 0, draw.countBuffer.buffer, 0, draw.maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+            }
+            else if (draw.multiDrawIndirect)
+            {
+                // culled objects are left in the buffer with instanceCount 0
+                vkCmdDrawIndexedIndirect(commandBuffer, draw.indirectBuffer.buffer, 0, draw.maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+            }
+            else
+            {
+                for (uint32_t i = 0; i < draw.maxDrawCount; i++)
+                {
+                    vkCmdDrawIndexedIndirect(commandBuffer, draw.indirectBuffer.buffer, i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+                }
+            }
+        }
+        else if (draw.indexBuffer.amountElements != 0)
+        {
+            vkCmdBindIndexBuffer(commandBuffer, draw.indexBuffer.buffer, 0, draw.indexBuffer.indexType);
+            uint32_t indexCount = draw.indexCount != 0 ? draw.indexCount : static_cast<uint32_t>(draw.indexBuffer.amountElements);
+            vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, draw.vertexOffset, draw.firstInstance);
         }
         else
         {
-            vkCmdDraw(commandBuffer, vertexBuffer[i].amountElements, 1, 0, 0);
+            vkCmdDraw(commandBuffer, draw.vertexBuffer.amountElements, 1, 0, draw.firstInstance);
         }
     }
-    /*         VkViewport viewport{};
-            viewport.x = 0.0f;
-            viewport.y = 0.0f;
-            viewport.width = static_cast<float>(swapChainExtent.width);
-            viewport.height = static_cast<float>(swapChainExtent.height);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-            VkRect2D scissor{};
-            scissor.offset = {0, 0};
-            scissor.extent = swapChainExtent;
-            vkCmdSetScissor(commandBuffer, 0, 1, &scissor); */
+}
 
+void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, SwapChain swapchain, VkRenderPass renderPass, const std::vector<DrawCommand> &draws, const std::vector<ComputeDispatch> &dispatches, VkDescriptorSet textureSet, VkQueryPool statisticsQueries, uint32_t query, VkQueryPool occlusionQueries, uint32_t amountOcclusionQueries)
+{
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    recordDispatches(commandBuffer, dispatches, true);
+    if (statisticsQueries != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(commandBuffer, statisticsQueries, query, 1);
+        vkCmdBeginQuery(commandBuffer, statisticsQueries, query, 0);
+    }
+    if (occlusionQueries != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(commandBuffer, occlusionQueries, 0, amountOcclusionQueries);
+    }
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = swapchain.framebuffers[imageIndex];
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = swapchain.extent;
+    VkClearValue clearValues[2]{};
+    clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    clearValues[1].depthStencil = {1.0f, 0};
+    renderPassInfo.clearValueCount = swapchain.depthFormat != VK_FORMAT_UNDEFINED ? 2 : 1;
+    renderPassInfo.pClearValues = clearValues;
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    recordDraws(commandBuffer, swapchain.extent, draws, textureSet, occlusionQueries);
     vkCmdEndRenderPass(commandBuffer);
+    if (statisticsQueries != VK_NULL_HANDLE)
+    {
+        vkCmdEndQuery(commandBuffer, statisticsQueries, query);
+    }
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to record command buffer!");
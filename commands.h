@@ -3,10 +3,18 @@
 
 #include "common.cpp"
 
+VkCommandPool createCommandPool(uint32_t queueFamily, VkDevice logicalDevice);
 VkCommandPool createCommandPool(QueueFamilyIndices queueIndices, VkDevice logicalDevice);
 VkCommandBuffer beginSingleTimeCommands(VkDevice logicalDevice, VkCommandPool commandPool);
 void endSingleTimeCommands(VkCommandBuffer commandBuffer, VkQueues queues, VkDevice logicalDevice, VkCommandPool commandPool);
+VkResult queueSubmit(VkQueues queues, VkQueue queue, const VkSubmitInfo &submitInfo, VkFence fence);
+VkResult queuePresent(VkQueues queues, const VkPresentInfoKHR &presentInfo);
 std::vector<VkCommandBuffer> createCommandBuffers(int size, VkCommandPool pool, VkDevice device);
-void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, GraphicsPipeline graphicsPipeline, SwapChain swapchain, VkRenderPass renderPass, std::vector<Uniforms> uniforms, int currentFrame, std::vector<Buffer> vertexBuffer, std::vector<Buffer> indexBuffer);
+void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, SwapChain swapchain, VkRenderPass renderPass, const std::vector<DrawCommand> &draws, const std::vector<ComputeDispatch> &dispatches, VkDescriptorSet textureSet, VkQueryPool statisticsQueries, uint32_t query, VkQueryPool occlusionQueries, uint32_t amountOcclusionQueries);
+void recordDraws(VkCommandBuffer commandBuffer, VkExtent2D extent, const std::vector<DrawCommand> &draws, VkDescriptorSet textureSet, VkQueryPool occlusionQueries = VK_NULL_HANDLE);
+VkQueryPool createStatisticsQueryPool(int size, VkDevice logicalDevice);
+VkQueryPool createOcclusionQueryPool(uint32_t size, VkDevice logicalDevice);
+void sortDrawCommands(std::vector<DrawCommand> &draws);
+void countTriangles(const std::vector<DrawCommand> &draws, uint64_t &submitted, uint64_t &fullDetail);
 
 #endif
\ No newline at end of file
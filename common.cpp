@@ -17,6 +17,17 @@
 #include <set>
 #include <array>
 #include <chrono>
+#include <string>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <cmath>
 
 #include "vulkan/vulkan.h"
 #include "GLFW/glfw3.h"
@@ -0,0 +1,432 @@
+#include "common.cpp"
+#include "vkMemory.h"
+#include "image.h"
+#include "compressedTexture.h"
+
+static const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// bytes per 4x4 block, 0 for the uncompressed R8 masks
+static uint32_t blockBytes(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+    case VK_FORMAT_R8_UNORM:
+        return 0;
+    default:
+        throw std::runtime_error("unsupported compressed texture format!");
+    }
+}
+
+VkDeviceSize levelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    uint32_t bytes = blockBytes(format);
+    if (bytes == 0)
+    {
+        return static_cast<VkDeviceSize>(width) * height;
+    }
+    return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * bytes;
+}
+
+template <typename T>
+static T readValue(const std::vector<uint8_t> &file, size_t offset)
+{
+    if (offset + sizeof(T) > file.size())
+    {
+        throw std::runtime_error("truncated texture file!");
+    }
+    T value;
+    memcpy(&value, file.data() + offset, sizeof(T));
+    return value;
+}
+
+static std::vector<uint8_t> readTextureFile(std::string path)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open texture file " + path);
+    }
+    std::vector<uint8_t> buffer(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+    return buffer;
+}
+
+// supercompressed files (BasisLZ, zstd) are not supported; the level index starts with the base level
+static CompressedImage parseKTX2(std::vector<uint8_t> file)
+{
+    if (file.size() < 80 || memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+    {
+        throw std::runtime_error("not a KTX2 file!");
+    }
+    CompressedImage image;
+    image.format = static_cast<VkFormat>(readValue<uint32_t>(file, 12));
+    image.width = readValue<uint32_t>(file, 20);
+    image.height = readValue<uint32_t>(file, 24);
+    uint32_t layerCount = readValue<uint32_t>(file, 32);
+    uint32_t faceCount = readValue<uint32_t>(file, 36);
+    uint32_t levelCount = std::max(readValue<uint32_t>(file, 40), 1u);
+    uint32_t supercompression = readValue<uint32_t>(file, 44);
+    if (layerCount > 1 || faceCount != 1 || supercompression != 0)
+    {
+        throw std::runtime_error("only single 2D KTX2 images without supercompression are supported!");
+    }
+    blockBytes(image.format);
+
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        size_t entry = 80 + i * 24;
+        auto offset = readValue<uint64_t>(file, entry);
+        auto length = readValue<uint64_t>(file, entry + 8);
+        if (offset + length > file.size() || length < levelSize(image.format, std::max(image.width >> i, 1u), std::max(image.height >> i, 1u)))
+        {
+            throw std::runtime_error("invalid KTX2 mip level!");
+        }
+        image.levelOffsets.push_back(image.data.size());
+        image.data.insert(image.data.end(), file.begin() + offset, file.begin() + offset + length);
+    }
+    return image;
+}
+
+static VkFormat ddsFourCCFormat(uint32_t fourCC)
+{
+    auto code = [](const char *c)
+    { return uint32_t(c[0]) | uint32_t(c[1]) << 8 | uint32_t(c[2]) << 16 | uint32_t(c[3]) << 24; };
+    if (fourCC == code("DXT1"))
+    {
+        return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    }
+    if (fourCC == code("DXT5"))
+    {
+        return VK_FORMAT_BC3_UNORM_BLOCK;
+    }
+    if (fourCC == code("ATI1") || fourCC == code("BC4U"))
+    {
+        return VK_FORMAT_BC4_UNORM_BLOCK;
+    }
+    if (fourCC == code("ATI2") || fourCC == code("BC5U"))
+    {
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    }
+    throw std::runtime_error("unsupported DDS format!");
+}
+
+static VkFormat ddsDXGIFormat(uint32_t dxgiFormat)
+{
+    switch (dxgiFormat)
+    {
+    case 61:
+        return VK_FORMAT_R8_UNORM;
+    case 71:
+        return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case 72:
+        return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case 77:
+        return VK_FORMAT_BC3_UNORM_BLOCK;
+    case 78:
+        return VK_FORMAT_BC3_SRGB_BLOCK;
+    case 80:
+        return VK_FORMAT_BC4_UNORM_BLOCK;
+    case 83:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case 98:
+        return VK_FORMAT_BC7_UNORM_BLOCK;
+    case 99:
+        return VK_FORMAT_BC7_SRGB_BLOCK;
+    default:
+        throw std::runtime_error("unsupported DDS format!");
+    }
+}
+
+// levels are stored largest first right after the headers
+static CompressedImage parseDDS(std::vector<uint8_t> file)
+{
+    const uint32_t DDPF_FOURCC = 0x4, DDPF_LUMINANCE = 0x20000;
+    if (file.size() < 128 || memcmp(file.data(), "DDS ", 4) != 0)
+    {
+        throw std::runtime_error("not a DDS file!");
+    }
+    CompressedImage image;
+    image.height = readValue<uint32_t>(file, 12);
+    image.width = readValue<uint32_t>(file, 16);
+    uint32_t levelCount = std::max(readValue<uint32_t>(file, 28), 1u);
+    uint32_t pixelFlags = readValue<uint32_t>(file, 80);
+    uint32_t fourCC = readValue<uint32_t>(file, 84);
+    uint32_t bitCount = readValue<uint32_t>(file, 88);
+    size_t offset = 128;
+    if ((pixelFlags & DDPF_FOURCC) && memcmp(file.data() + 84, "DX10", 4) == 0)
+    {
+        image.format = ddsDXGIFormat(readValue<uint32_t>(file, 128));
+        offset += 20;
+    }
+    else if (pixelFlags & DDPF_FOURCC)
+    {
+        image.format = ddsFourCCFormat(fourCC);
+    }
+    else if ((pixelFlags & DDPF_LUMINANCE) && bitCount == 8)
+    {
+        image.format = VK_FORMAT_R8_UNORM;
+    }
+    else
+    {
+        throw std::runtime_error("unsupported DDS format!");
+    }
+
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        auto size = levelSize(image.format, std::max(image.width >> i, 1u), std::max(image.height >> i, 1u));
+        if (offset + size > file.size())
+        {
+            throw std::runtime_error("truncated DDS file!");
+        }
+        image.levelOffsets.push_back(image.data.size());
+        image.data.insert(image.data.end(), file.begin() + offset, file.begin() + offset + size);
+        offset += size;
+    }
+    return image;
+}
+
+// BC1 decides per block between four colors and three colors plus black, BC3 color blocks always have four
+static void decodeColors565(uint16_t c0, uint16_t c1, bool alwaysFourColors, bool punchThroughAlpha, uint8_t colors[4][4])
+{
+    uint16_t endpoints[] = {c0, c1};
+    for (int i = 0; i < 2; i++)
+    {
+        colors[i][0] = static_cast<uint8_t>(((endpoints[i] >> 11) & 31) * 255 / 31);
+        colors[i][1] = static_cast<uint8_t>(((endpoints[i] >> 5) & 63) * 255 / 63);
+        colors[i][2] = static_cast<uint8_t>((endpoints[i] & 31) * 255 / 31);
+        colors[i][3] = 255;
+    }
+    bool fourColors = alwaysFourColors || c0 > c1;
+    for (int c = 0; c < 3; c++)
+    {
+        if (fourColors)
+        {
+            colors[2][c] = static_cast<uint8_t>((2 * colors[0][c] + colors[1][c]) / 3);
+            colors[3][c] = static_cast<uint8_t>((colors[0][c] + 2 * colors[1][c]) / 3);
+        }
+        else
+        {
+            colors[2][c] = static_cast<uint8_t>((colors[0][c] + colors[1][c]) / 2);
+            colors[3][c] = 0;
+        }
+    }
+    colors[2][3] = 255;
+    colors[3][3] = fourColors || !punchThroughAlpha ? 255 : 0;
+}
+
+// BC4 style block: two endpoints and 16 3 bit indices
+static void decodeChannel(const uint8_t *block, uint8_t values[16])
+{
+    uint8_t palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+    if (block[0] > block[1])
+    {
+        for (int i = 1; i < 7; i++)
+        {
+            palette[i + 1] = static_cast<uint8_t>(((7 - i) * block[0] + i * block[1]) / 7);
+        }
+    }
+    else
+    {
+        for (int i = 1; i < 5; i++)
+        {
+            palette[i + 1] = static_cast<uint8_t>(((5 - i) * block[0] + i * block[1]) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        values[i] = palette[(indices >> (3 * i)) & 7];
+    }
+}
+
+// format the CPU transcode decodes into, BC7 has no decoder here
+static VkFormat transcodeFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        return VK_FORMAT_R8G8B8A8_SRGB;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        return VK_FORMAT_R8_UNORM;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        return VK_FORMAT_R8G8_UNORM;
+    default:
+        throw std::runtime_error("no CPU transcode for the unsupported texture format!");
+    }
+}
+
+static uint32_t channelCount(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+        return 1;
+    case VK_FORMAT_R8G8_UNORM:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+static std::vector<uint8_t> decodeLevel(VkFormat format, const uint8_t *data, uint32_t width, uint32_t height)
+{
+    VkFormat target = transcodeFormat(format);
+    uint32_t channels = channelCount(target);
+    std::vector<uint8_t> texels(static_cast<size_t>(width) * height * channels);
+    uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    bool bc3 = format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK;
+    bool punchThroughAlpha = format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    for (uint32_t by = 0; by < blocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            const uint8_t *block = data + (by * blocksX + bx) * blockBytes(format);
+            uint8_t decoded[16][4] = {};
+            if (target == VK_FORMAT_R8_UNORM || target == VK_FORMAT_R8G8_UNORM)
+            {
+                uint8_t values[16];
+                for (uint32_t c = 0; c < channels; c++)
+                {
+                    decodeChannel(block + 8 * c, values);
+                    for (int i = 0; i < 16; i++)
+                    {
+                        decoded[i][c] = values[i];
+                    }
+                }
+            }
+            else
+            {
+                const uint8_t *colorBlock = bc3 ? block + 8 : block;
+                uint8_t colors[4][4];
+                uint16_t c0 = colorBlock[0] | colorBlock[1] << 8;
+                uint16_t c1 = colorBlock[2] | colorBlock[3] << 8;
+                decodeColors565(c0, c1, bc3, punchThroughAlpha, colors);
+                uint32_t indices = colorBlock[4] | colorBlock[5] << 8 | colorBlock[6] << 16 | static_cast<uint32_t>(colorBlock[7]) << 24;
+                for (int i = 0; i < 16; i++)
+                {
+                    memcpy(decoded[i], colors[(indices >> (2 * i)) & 3], 4);
+                }
+                if (bc3)
+                {
+                    uint8_t alpha[16];
+                    decodeChannel(block, alpha);
+                    for (int i = 0; i < 16; i++)
+                    {
+                        decoded[i][3] = alpha[i];
+                    }
+                }
+            }
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+            {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+                {
+                    memcpy(&texels[((by * 4 + y) * width + bx * 4 + x) * channels], decoded[y * 4 + x], channels);
+                }
+            }
+        }
+    }
+    return texels;
+}
+
+bool checkSampledSupport(VkFormat format, VkPhysicalDevice physicalDevice)
+{
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    return properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+}
+
+CompressedImage loadCompressedImage(std::string path)
+{
+    auto extension = path.substr(path.find_last_of('.') + 1);
+    if (extension == "ktx2")
+    {
+        return parseKTX2(readTextureFile(path));
+    }
+    if (extension == "dds")
+    {
+        return parseDDS(readTextureFile(path));
+    }
+    throw std::runtime_error("unknown texture container " + path);
+}
+
+// decodes every level into the transcode format, for devices without the block compressed format
+CompressedImage transcodeImage(const CompressedImage &image)
+{
+    if (image.format == VK_FORMAT_R8_UNORM)
+    {
+        return image;
+    }
+    CompressedImage result;
+    result.format = transcodeFormat(image.format);
+    result.width = image.width;
+    result.height = image.height;
+    for (size_t i = 0; i < image.levelOffsets.size(); i++)
+    {
+        auto level = decodeLevel(image.format, image.data.data() + image.levelOffsets[i], std::max(image.width >> i, 1u), std::max(image.height >> i, 1u));
+        result.levelOffsets.push_back(result.data.size());
+        result.data.insert(result.data.end(), level.begin(), level.end());
+    }
+    return result;
+}
+
+// textures/<fileName>, a .ktx2 or .dds file; all stored mip levels are uploaded as they are
+Texture createCompressedTexture(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueues queues, std::string fileName)
+{
+    auto image = loadCompressedImage("textures/" + fileName);
+    if (!checkSampledSupport(image.format, physicalDevice))
+    {
+        image = transcodeImage(image);
+    }
+    uint32_t mipLevels = static_cast<uint32_t>(image.levelOffsets.size());
+    VkDeviceSize imageSize = image.data.size();
+
+    auto stagingBuffer = createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+    void *data;
+    vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, imageSize, 0, &data);
+    memcpy(data, image.data.data(), static_cast<size_t>(imageSize));
+    vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
+
+    std::vector<VkBufferImageCopy> regions;
+    for (uint32_t i = 0; i < mipLevels; i++)
+    {
+        regions.push_back(mipCopyRegion(image.levelOffsets[i], i, std::max(image.width >> i, 1u), std::max(image.height >> i, 1u)));
+    }
+
+    Texture texture;
+    texture.format = image.format;
+    texture.mipLevels = mipLevels;
+    createImage(image.width, image.height, mipLevels, image.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.textureImage, texture.textureImageMemory, logicalDevice, physicalDevice);
+    transitionImageLayout(texture.textureImage, image.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, mipLevels, logicalDevice, commandPool, queues);
+    copyBufferToImage(stagingBuffer.buffer, texture.textureImage, regions, logicalDevice, commandPool, queues);
+    transitionImageLayout(texture.textureImage, image.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, mipLevels, logicalDevice, commandPool, queues);
+    vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
+    vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
+    return texture;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#ifndef compressedTexture_h
+#define compressedTexture_h
+
+#include "common.cpp"
+
+CompressedImage loadCompressedImage(std::string path);
+CompressedImage transcodeImage(const CompressedImage &image);
+// bytes of one level of a block compressed or R8 image
+VkDeviceSize levelSize(VkFormat format, uint32_t width, uint32_t height);
+bool checkSampledSupport(VkFormat format, VkPhysicalDevice physicalDevice);
+Texture createCompressedTexture(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueues queues, std::string fileName);
+
+#endif
\ No newline at end of file
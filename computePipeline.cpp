@@ -0,0 +1,182 @@
+#include "common.cpp"
+#include "computePipeline.h"
+
+ComputePipeline createComputePipeline(std::string shaderName, VkDescriptorSetLayout descriptorLayout, uint32_t pushConstantSize, VkDevice logicalDevice, VkPipelineCache pipelineCache, ShaderRegistry &shaders, LayoutCache &layouts)
+{
+    auto shader = shaders.acquire("./shader/" + shaderName + "_cs.spv");
+
+    VkPipelineShaderStageCreateInfo stageInfo{};
+    stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stageInfo.module = shader;
+    stageInfo.pName = "main";
+
+    std::vector<VkPushConstantRange> pushConstants;
+    if (pushConstantSize > 0)
+    {
+        pushConstants.push_back(VkPushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, pushConstantSize});
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = stageInfo;
+    try
+    {
+        pipelineInfo.layout = layouts.getPipelineLayout(std::vector<VkDescriptorSetLayout>{descriptorLayout}, pushConstants);
+    }
+    catch (...)
+    {
+        shaders.release(shader);
+        throw;
+    }
+
+    ComputePipeline pipeline;
+    if (vkCreateComputePipelines(logicalDevice, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline.pipeline) != VK_SUCCESS)
+    {
+        shaders.release(shader);
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+    pipeline.layout = pipelineInfo.layout;
+    pipeline.shader = shader;
+    return pipeline;
+}
+
+VkDescriptorSetLayout createComputeDescriptorSetLayout(LayoutCache &layouts, std::vector<VkDescriptorType> types)
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings(types.size());
+    for (int i = 0; i < types.size(); i++)
+    {
+        VkDescriptorSetLayoutBinding layout{};
+        layout.binding = i;
+        layout.descriptorType = types[i];
+        layout.descriptorCount = 1;
+        layout.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i] = layout;
+    }
+    return layouts.getDescriptorSetLayout(bindings);
+}
+
+void writeStorageBuffer(VkDescriptorSet set, uint32_t binding, Buffer buffer, VkDevice logicalDevice)
+{
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer.buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.dstArrayElement = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(logicalDevice, 1, &write, 0, nullptr);
+}
+
+void writeStorageImage(VkDescriptorSet set, uint32_t binding, VkImageView view, VkDevice logicalDevice)
+{
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageView = view;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = binding;
+    write.dstArrayElement = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(logicalDevice, 1, &write, 0, nullptr);
+}
+
+// records the dispatches outside of any render pass. Each dispatch sees the writes of the ones before it,
+// with graphicsReaders everything written is afterwards visible to vertex input, indirect draws and all shader stages.
+// Compute only queues can't wait on graphics stages, standalone jobs rely on the fence wait instead
+void recordDispatches(VkCommandBuffer commandBuffer, const std::vector<ComputeDispatch> &dispatches, bool graphicsReaders)
+{
+    if (dispatches.empty())
+    {
+        return;
+    }
+    VkPipelineStageFlags readers = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    if (graphicsReaders)
+    {
+        // the previous frame may still be reading what gets overwritten here
+        vkCmdPipelineBarrier(commandBuffer, readers, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+    }
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    for (size_t i = 0; i < dispatches.size(); i++)
+    {
+        auto &dispatch = dispatches[i];
+        for (auto &buffer : dispatch.bufferClears)
+        {
+            vkCmdFillBuffer(commandBuffer, buffer.buffer, 0, VK_WHOLE_SIZE, 0);
+        }
+        if (!dispatch.bufferClears.empty())
+        {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+        if (i > 0)
+        {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, dispatch.pipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, dispatch.layout, 0, 1, &dispatch.descriptorSet, 0, nullptr);
+        if (!dispatch.pushConstants.empty())
+        {
+            vkCmdPushConstants(commandBuffer, dispatch.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, static_cast<uint32_t>(dispatch.pushConstants.size()), dispatch.pushConstants.data());
+        }
+        vkCmdDispatch(commandBuffer, dispatch.groupCountX, dispatch.groupCountY, dispatch.groupCountZ);
+
+        for (auto &buffer : dispatch.bufferWrites)
+        {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffer.buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(barrier);
+        }
+        for (auto image : dispatch.imageWrites)
+        {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+            imageBarriers.push_back(barrier);
+        }
+    }
+    if (!graphicsReaders)
+    {
+        return;
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readers, 0,
+                         0, nullptr,
+                         static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                         static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
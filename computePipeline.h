@@ -0,0 +1,14 @@
+#ifndef compute_pipeline_h
+#define compute_pipeline_h
+
+#include "common.cpp"
+#include "shaderRegistry.h"
+#include "layoutCache.h"
+
+ComputePipeline createComputePipeline(std::string shaderName, VkDescriptorSetLayout descriptorLayout, uint32_t pushConstantSize, VkDevice logicalDevice, VkPipelineCache pipelineCache, ShaderRegistry &shaders, LayoutCache &layouts);
+VkDescriptorSetLayout createComputeDescriptorSetLayout(LayoutCache &layouts, std::vector<VkDescriptorType> types);
+void writeStorageBuffer(VkDescriptorSet set, uint32_t binding, Buffer buffer, VkDevice logicalDevice);
+void writeStorageImage(VkDescriptorSet set, uint32_t binding, VkImageView view, VkDevice logicalDevice);
+void recordDispatches(VkCommandBuffer commandBuffer, const std::vector<ComputeDispatch> &dispatches, bool graphicsReaders);
+
+#endif
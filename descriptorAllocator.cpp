@@ -0,0 +1,99 @@
+#include "common.cpp"
+#include "graphicsPipeline.h"
+#include "descriptorAllocator.h"
+
+const uint32_t MAX_SETS_PER_POOL = 4096;
+
+void DescriptorAllocator::init(VkDevice logicalDevice, uint32_t setsPerPool, LayoutCache *layoutCache)
+{
+    this->logicalDevice = logicalDevice;
+    this->setsPerPool = setsPerPool;
+    this->layoutCache = layoutCache;
+}
+
+VkDescriptorPool DescriptorAllocator::grabPool()
+{
+    VkDescriptorPool pool;
+    if (!freePools.empty())
+    {
+        pool = freePools.back();
+        freePools.pop_back();
+    }
+    else
+    {
+        pool = createDescriptorPool(setsPerPool, logicalDevice);
+        // every new pool is bigger than the last one, so large scenes need few pools
+        setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+    }
+    usedPools.push_back(pool);
+    return pool;
+}
+
+std::vector<VkDescriptorSet> DescriptorAllocator::allocate(VkDescriptorSetLayout layout, int amount)
+{
+    if (currentPool == VK_NULL_HANDLE)
+    {
+        currentPool = grabPool();
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(amount, layout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = currentPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(amount);
+    allocInfo.pSetLayouts = layouts.data();
+
+    std::vector<VkDescriptorSet> descriptorSets(amount);
+    auto result = vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data());
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        currentPool = grabPool();
+        allocInfo.descriptorPool = currentPool;
+        result = vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data());
+    }
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        // even a fresh pool is too small for this layout (or amount), so it gets a pool sized for exactly this request
+        auto pool = createDescriptorPool(static_cast<uint32_t>(amount), layoutCache->getPoolSizes(layout, static_cast<uint32_t>(amount)), logicalDevice);
+        dedicatedPools.push_back(pool);
+        allocInfo.descriptorPool = pool;
+        result = vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data());
+    }
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+    return descriptorSets;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    return allocate(layout, 1)[0];
+}
+
+// frees every set handed out so far, the caller must make sure the GPU is done with them
+void DescriptorAllocator::reset()
+{
+    for (auto pool : usedPools)
+    {
+        vkResetDescriptorPool(logicalDevice, pool, 0);
+        freePools.push_back(pool);
+    }
+    usedPools.clear();
+    currentPool = VK_NULL_HANDLE;
+    for (auto pool : dedicatedPools)
+    {
+        vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
+    }
+    dedicatedPools.clear();
+}
+
+void DescriptorAllocator::destroy()
+{
+    reset();
+    for (auto pool : freePools)
+    {
+        vkDestroyDescriptorPool(logicalDevice, pool, nullptr);
+    }
+    freePools.clear();
+}
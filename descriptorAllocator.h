@@ -0,0 +1,30 @@
+#ifndef descriptor_allocator_h
+#define descriptor_allocator_h
+
+#include "common.cpp"
+#include "layoutCache.h"
+
+// hands out descriptor sets from a growing list of pools, reset() recycles all of them at once
+class DescriptorAllocator
+{
+public:
+    void init(VkDevice logicalDevice, uint32_t setsPerPool, LayoutCache *layoutCache);
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    std::vector<VkDescriptorSet> allocate(VkDescriptorSetLayout layout, int amount);
+    void reset();
+    void destroy();
+
+private:
+    VkDevice logicalDevice;
+    uint32_t setsPerPool;
+    LayoutCache *layoutCache;
+    VkDescriptorPool currentPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPool> usedPools;
+    std::vector<VkDescriptorPool> freePools;
+    // sized for one allocation whose layout does not fit the shared pools, destroyed on reset
+    std::vector<VkDescriptorPool> dedicatedPools;
+
+    VkDescriptorPool grabPool();
+};
+
+#endif
@@ -14,6 +14,10 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR &surf
         {
             indices.graphicsFamily = i;
         }
+        if ((x.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(x.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            indices.computeFamily = i;
+        }
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
         if (presentSupport)
@@ -22,6 +26,11 @@ QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR &surf
         }
         i++;
     }
+    // graphics families always support compute
+    if (!indices.computeFamily.has_value())
+    {
+        indices.computeFamily = indices.graphicsFamily;
+    }
     return indices;
 }
 
@@ -117,14 +126,82 @@ QueueFamilyIndices getIndices(VkPhysicalDevice device, VkSurfaceKHR surface)
     return findQueueFamilies(device, surface);
 }
 
-VkDevice createLogicalDevice(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
+// descriptor indexing as needed by the bindless texture table, core since Vulkan 1.2
+bool checkBindlessSupport(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2)
+    {
+        return false;
+    }
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    return vulkan12Features.descriptorIndexing &&
+           vulkan12Features.runtimeDescriptorArray &&
+           vulkan12Features.descriptorBindingPartiallyBound &&
+           vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+           vulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+           vulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+}
+
+// vkCmdDrawIndexedIndirectCount, core since Vulkan 1.2
+bool checkDrawIndirectCountSupport(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_2)
+    {
+        return false;
+    }
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    return vulkan12Features.drawIndirectCount;
+}
+
+bool checkPipelineStatisticsSupport(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(device, &features);
+    return features.pipelineStatisticsQuery;
+}
+
+bool checkMultiDrawIndirectSupport(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(device, &features);
+    return features.multiDrawIndirect;
+}
+
+bool checkDrawIndirectFirstInstanceSupport(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(device, &features);
+    return features.drawIndirectFirstInstance;
+}
+
+VkDevice createLogicalDevice(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, bool bindless, bool pipelineStatistics, bool drawIndirectCount)
 {
     std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.pipelineStatisticsQuery = pipelineStatistics ? VK_TRUE : VK_FALSE;
+    // GPU generated draws: many draws per indirect call, object index passed as firstInstance
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
     auto indices = getIndices(physicalDevice, surface);
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentableFamily.value()};
+    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentableFamily.value(), indices.computeFamily.value()};
     auto queuePrio = 1.0f;
     for (auto x : uniqueQueueFamilies)
     {
@@ -143,6 +220,28 @@ VkDevice createLogicalDevice(VkPhysicalDevice physicalDevice, VkSurfaceKHR surfa
     info.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
     info.ppEnabledExtensionNames = deviceExtensions.data();
     info.pEnabledFeatures = &deviceFeatures;
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    vulkan12Features.drawIndirectCount = drawIndirectCount ? VK_TRUE : VK_FALSE;
+    if (bindless || drawIndirectCount)
+    {
+        features.features = deviceFeatures;
+        features.pNext = &vulkan12Features;
+        info.pNext = &features;
+        info.pEnabledFeatures = nullptr;
+    }
+    if (bindless)
+    {
+        vulkan12Features.descriptorIndexing = VK_TRUE;
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    }
     VkDevice logicalDevice;
     vkCreateDevice(physicalDevice, &info, nullptr, &logicalDevice);
     return logicalDevice;
@@ -153,5 +252,6 @@ VkQueues getQueues(VkDevice logicalDevice, QueueFamilyIndices indices)
     VkQueues queues;
     vkGetDeviceQueue(logicalDevice, indices.graphicsFamily.value(), 0, &queues.graphicsQueue);
     vkGetDeviceQueue(logicalDevice, indices.presentableFamily.value(), 0, &queues.presentationQueue);
+    vkGetDeviceQueue(logicalDevice, indices.computeFamily.value(), 0, &queues.computeQueue);
     return queues;
 }
\ No newline at end of file
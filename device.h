@@ -8,7 +8,12 @@ SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurface
 VkPhysicalDevice pickPhysicalDevice(VkInstance &instance, VkSurfaceKHR &surface);
 QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR &surface);
 VkQueues getQueues(VkDevice logicalDevice, QueueFamilyIndices indices);
-VkDevice createLogicalDevice(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
+bool checkBindlessSupport(VkPhysicalDevice device);
+bool checkDrawIndirectCountSupport(VkPhysicalDevice device);
+bool checkPipelineStatisticsSupport(VkPhysicalDevice device);
+bool checkMultiDrawIndirectSupport(VkPhysicalDevice device);
+bool checkDrawIndirectFirstInstanceSupport(VkPhysicalDevice device);
+VkDevice createLogicalDevice(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, bool bindless, bool pipelineStatistics, bool drawIndirectCount);
 QueueFamilyIndices getIndices(VkPhysicalDevice device, VkSurfaceKHR surface);
 SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR &surface);
 
@@ -1,19 +1,8 @@
 #include "common.cpp"
 #include "vertex.h"
-static std::vector<char> readFile(const std::string &filename)
-{
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-    if (!file.is_open())
-    {
-        std::runtime_error("failed to open file");
-    }
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-    return buffer;
-}
+#include "shaderRegistry.h"
+#include "descriptorAllocator.h"
+#include "layoutCache.h"
 
 VkRenderPass createRenderPass(SwapChain swapchain, VkDevice logicalDevice)
 {
@@ -31,20 +20,39 @@ VkRenderPass createRenderPass(SwapChain swapchain, VkDevice logicalDevice)
     colourAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     colourAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
+    // depth is only needed during the pass, never stored
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = swapchain.depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    bool hasDepth = swapchain.depthFormat != VK_FORMAT_UNDEFINED;
+
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = hasDepth ? &depthAttachmentRef : nullptr;
 
+    VkAttachmentDescription attachments[] = {colourAttachment, depthAttachment};
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colourAttachment;
+    renderPassInfo.attachmentCount = hasDepth ? 2 : 1;
+    renderPassInfo.pAttachments = attachments;
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
 
@@ -55,6 +63,14 @@ VkRenderPass createRenderPass(SwapChain swapchain, VkDevice logicalDevice)
     dependency.srcAccessMask = 0;
     dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    if (hasDepth)
+    {
+        // the shared depth image is cleared while the previous frame may still test against it
+        dependency.srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    }
     renderPassInfo.dependencyCount = 1;
     renderPassInfo.pDependencies = &dependency;
 
@@ -66,7 +82,7 @@ VkRenderPass createRenderPass(SwapChain swapchain, VkDevice logicalDevice)
     return renderPass;
 }
 
-VkDescriptorSetLayout createDescriptorSetLayout(VkDevice logicalDevice, std::vector<VkDescriptorType> types, int amountVertexShader)
+VkDescriptorSetLayout createDescriptorSetLayout(LayoutCache &layouts, std::vector<VkDescriptorType> types, int amountVertexShader)
 {
     std::vector<VkDescriptorSetLayoutBinding> bindings(types.size());
     for (int i = 0; i < types.size(); i++)
@@ -85,33 +101,16 @@ VkDescriptorSetLayout createDescriptorSetLayout(VkDevice logicalDevice, std::vec
         }
         bindings[i] = layout;
     }
-
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
-
-    VkDescriptorSetLayout layout;
-    if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create descriptor set layout!");
-    }
-    return layout;
+    return layouts.getDescriptorSetLayout(bindings);
 }
 
-VkDescriptorPool createDescriptorPool(int size, VkDevice logicalDevice)
+VkDescriptorPool createDescriptorPool(uint32_t maxSets, std::vector<VkDescriptorPoolSize> poolSizes, VkDevice logicalDevice)
 {
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(size);
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(size);
-
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(size);
+    poolInfo.maxSets = maxSets;
 
     VkDescriptorPool pool;
     if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS)
@@ -121,29 +120,61 @@ VkDescriptorPool createDescriptorPool(int size, VkDevice logicalDevice)
     return pool;
 }
 
-VkShaderModule createShaderModule(const std::vector<char> &shaderBytecode, VkDevice logicalDevice)
+VkDescriptorPool createDescriptorPool(int size, VkDevice logicalDevice)
+{
+    // room for two descriptors of each type per set
+    std::vector<VkDescriptorPoolSize> poolSizes(4);
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = static_cast<uint32_t>(size * 2);
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = static_cast<uint32_t>(size * 2);
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = static_cast<uint32_t>(size * 2);
+    poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[3].descriptorCount = static_cast<uint32_t>(size * 2);
+
+    return createDescriptorPool(static_cast<uint32_t>(size), poolSizes, logicalDevice);
+}
+
+VkPipelineCache createPipelineCache(VkDevice logicalDevice)
 {
-    VkShaderModuleCreateInfo info{};
-    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    info.codeSize = shaderBytecode.size();
-    info.pCode = reinterpret_cast<const uint32_t *>(shaderBytecode.data());
+    VkPipelineCacheCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
 
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(logicalDevice, &info, nullptr, &shaderModule) != VK_SUCCESS)
+    VkPipelineCache pipelineCache;
+    if (vkCreatePipelineCache(logicalDevice, &info, nullptr, &pipelineCache) != VK_SUCCESS)
     {
-        throw std::runtime_error("failed shader module creation");
+        throw std::runtime_error("failed to create pipeline cache!");
     }
-    return shaderModule;
+    return pipelineCache;
+}
+
+PipelineDescription createPipelineDescription(std::string shaderName, VkDescriptorSetLayout descriptorLayout, VkRenderPass renderPass, VertexInput vertexInput)
+{
+    PipelineDescription description;
+    description.shaderName = shaderName;
+    description.descriptorLayout = descriptorLayout;
+    description.renderPass = renderPass;
+    description.vertexBinding = vertexInput.binding;
+    description.vertexAttributes = vertexInput.attributes;
+    return description;
 }
 
-GraphicsPipeline createGraphicsPipeline(std::string shaderName, VkDevice logicalDevice, SwapChain swapchain, VkDescriptorSetLayout descriptorLayout, VkRenderPass renderPass)
+GraphicsPipeline createGraphicsPipeline(PipelineDescription description, VkDevice logicalDevice, VkPipelineCache pipelineCache, ShaderRegistry &shaders, LayoutCache &layouts)
 {
-    auto vertName = "./shader/" + shaderName + "_vs.spv";
-    auto fragName = "./shader/" + shaderName + "_fs.spv";
-    auto vertShaderCode = readFile(vertName);
-    auto fragShaderCode = readFile(fragName);
-    auto vertShader = createShaderModule(vertShaderCode, logicalDevice);
-    auto fragShader = createShaderModule(fragShaderCode, logicalDevice);
+    auto vertName = "./shader/" + description.shaderName + "_vs.spv";
+    auto fragName = "./shader/" + description.shaderName + "_fs.spv";
+    auto vertShader = shaders.acquire(vertName);
+    VkShaderModule fragShader;
+    try
+    {
+        fragShader = shaders.acquire(fragName);
+    }
+    catch (...)
+    {
+        shaders.release(vertShader);
+        throw;
+    }
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -160,75 +191,67 @@ GraphicsPipeline createGraphicsPipeline(std::string shaderName, VkDevice logical
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(description.vertexAttributes.size());
+    vertexInputInfo.pVertexBindingDescriptions = &description.vertexBinding;
+    vertexInputInfo.pVertexAttributeDescriptions = description.vertexAttributes.data();
 
     VkPipelineInputAssemblyStateCreateInfo assembly{};
     assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    assembly.topology = description.topology;
     assembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport{};
-    viewport.x = 0;
-    viewport.y = 0;
-    viewport.width = swapchain.extent.width;
-    viewport.height = swapchain.extent.height;
-    viewport.minDepth = 0;
-    viewport.maxDepth = 0;
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swapchain.extent;
-
-    // möglicherweise entfernen - dynamic viewport
-    /*    std::vector<VkDynamicState> dynamicStates = {
-           VK_DYNAMIC_STATE_VIEWPORT,
-           VK_DYNAMIC_STATE_SCISSOR,
-       };
-
-       VkPipelineDynamicStateCreateInfo dynamicState{};
-       dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-       dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-       dynamicState.pDynamicStates = dynamicStates.data();
-       VkPipelineViewportStateCreateInfo viewportState{};
-       viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-       viewportState.viewportCount = 1;
-       viewportState.scissorCount = 1; */
-
-    // static viewport
+    // viewport and scissor are set in recordCommandBuffer, so resizing never invalidates a pipeline
+    std::vector<VkDynamicState> dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR,
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
 
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizer.depthClampEnable = VK_FALSE;
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.polygonMode = description.polygonMode;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.cullMode = description.cullMode;
+    rasterizer.frontFace = description.frontFace;
     rasterizer.depthBiasEnable = VK_FALSE;
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    if (descriptorLayout != nullptr)
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    if (description.descriptorLayout != nullptr)
     {
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorLayout;
+        setLayouts.push_back(description.descriptorLayout);
     }
+    // shared between all pipelines with the same set layouts, so bound descriptor sets survive pipeline switches
     VkPipelineLayout pipelineLayout;
-    if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    try
+    {
+        if (description.textureLayout != nullptr)
+        {
+            if (setLayouts.empty())
+            {
+                setLayouts.push_back(layouts.getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding>{}));
+            }
+            setLayouts.push_back(description.textureLayout);
+        }
+        pipelineLayout = layouts.getPipelineLayout(setLayouts, description.pushConstants);
+    }
+    catch (...)
     {
-        throw std::runtime_error("failed to create pipeline layout");
+        shaders.release(vertShader);
+        shaders.release(fragShader);
+        throw;
     }
 
     printf("D\n");
@@ -244,8 +267,14 @@ GraphicsPipeline createGraphicsPipeline(std::string shaderName, VkDevice logical
     multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
+    colorBlendAttachment.colorWriteMask = description.colorWriteMask;
+    colorBlendAttachment.blendEnable = description.blendEnable ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
     VkPipelineColorBlendStateCreateInfo colorBlending{};
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -253,21 +282,32 @@ GraphicsPipeline createGraphicsPipeline(std::string shaderName, VkDevice logical
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments = &colorBlendAttachment;
 
+    // ignored by render passes without depth attachment
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = description.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = description.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
     pipelineInfo.pVertexInputState = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &assembly;
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.renderPass = description.renderPass;
     pipelineInfo.subpass = 0;
 
     VkPipeline pipeline;
-    if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(logicalDevice, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
     {
+        shaders.release(vertShader);
+        shaders.release(fragShader);
         throw std::runtime_error("failed to create graphics pipeline!");
     }
     GraphicsPipeline graphicsPipeline;
@@ -279,20 +319,9 @@ GraphicsPipeline createGraphicsPipeline(std::string shaderName, VkDevice logical
     return graphicsPipeline;
 }
 
-std::vector<VkDescriptorSet> createDescriptorSets(int size, VkDescriptorSetLayout layout, VkDescriptorPool pool, VkDevice logicalDevice, VkImageView view, std::vector<Buffer> uniformBuffers, VkSampler sampler)
+std::vector<VkDescriptorSet> createDescriptorSets(int size, VkDescriptorSetLayout layout, DescriptorAllocator &allocator, VkDevice logicalDevice, VkImageView view, std::vector<Buffer> uniformBuffers, VkSampler sampler, uint32_t imageBinding)
 {
-    std::vector<VkDescriptorSetLayout> layouts(size, layout);
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = pool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(size);
-    allocInfo.pSetLayouts = layouts.data();
-
-    std::vector<VkDescriptorSet> descriptorSets(size);
-    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate descriptor sets!");
-    }
+    auto descriptorSets = allocator.allocate(layout, size);
 
     for (size_t i = 0; i < size; i++)
     {
@@ -306,6 +335,7 @@ std::vector<VkDescriptorSet> createDescriptorSets(int size, VkDescriptorSetLayou
         imageInfo.imageView = view;
         imageInfo.sampler = sampler;
 
+        // without an image view the set only holds the uniform buffer (bindless textures)
         std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
 
         descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -318,13 +348,14 @@ std::vector<VkDescriptorSet> createDescriptorSets(int size, VkDescriptorSetLayou
 
         descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[1].dstSet = descriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstBinding = imageBinding;
         descriptorWrites[1].dstArrayElement = 0;
         descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         descriptorWrites[1].descriptorCount = 1;
         descriptorWrites[1].pImageInfo = &imageInfo;
 
-        vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+        uint32_t amountWrites = view != VK_NULL_HANDLE ? 2 : 1;
+        vkUpdateDescriptorSets(logicalDevice, amountWrites, descriptorWrites.data(), 0, nullptr);
     }
     return descriptorSets;
 }
@@ -2,12 +2,19 @@
 #define graphics_pipeline_h
 
 #include "common.cpp"
+#include "vertex.h"
+#include "shaderRegistry.h"
+#include "descriptorAllocator.h"
+#include "layoutCache.h"
 
 VkRenderPass createRenderPass(SwapChain swapchain, VkDevice logicalDevice);
-GraphicsPipeline createGraphicsPipeline(std::string shaderName, VkDevice logicalDevice, SwapChain swapchain, VkDescriptorSetLayout descriptorLayout, VkRenderPass renderPass);
+VkPipelineCache createPipelineCache(VkDevice logicalDevice);
+PipelineDescription createPipelineDescription(std::string shaderName, VkDescriptorSetLayout descriptorLayout, VkRenderPass renderPass, VertexInput vertexInput = SpriteVertex::Layout::input());
+GraphicsPipeline createGraphicsPipeline(PipelineDescription description, VkDevice logicalDevice, VkPipelineCache pipelineCache, ShaderRegistry &shaders, LayoutCache &layouts);
 VkDescriptorPool createDescriptorPool(int size, VkDevice logicalDevice);
-std::vector<VkDescriptorSet> createDescriptorSets(int size, VkDescriptorSetLayout layout, VkDescriptorPool pool, VkDevice logicalDevice, VkImageView view, std::vector<Buffer> uniformBuffers, VkSampler sampler);
+VkDescriptorPool createDescriptorPool(uint32_t maxSets, std::vector<VkDescriptorPoolSize> poolSizes, VkDevice logicalDevice);
+std::vector<VkDescriptorSet> createDescriptorSets(int size, VkDescriptorSetLayout layout, DescriptorAllocator &allocator, VkDevice logicalDevice, VkImageView view, std::vector<Buffer> uniformBuffers, VkSampler sampler, uint32_t imageBinding = 1);
 SyncObjects createSyncObjects(int amount, VkDevice logicalDevice);
-VkDescriptorSetLayout createDescriptorSetLayout(VkDevice logicalDevice, std::vector<VkDescriptorType> types, int amountVertexShader);
+VkDescriptorSetLayout createDescriptorSetLayout(LayoutCache &layouts, std::vector<VkDescriptorType> types, int amountVertexShader);
 
 #endif
\ No newline at end of file
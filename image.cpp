@@ -1,17 +1,18 @@
 #include "common.cpp"
 #include "vkMemory.h"
 #include "commands.h"
+#include "image.h"
 
-VkImageView createImageView(VkImage image, VkFormat format, VkDevice logicalDevice)
+VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t baseMipLevel, uint32_t mipLevels, VkDevice logicalDevice)
 {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = image;
     viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
     viewInfo.format = format;
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.aspectMask = aspectFlags;
+    viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
@@ -24,10 +25,40 @@ VkImageView createImageView(VkImage image, VkFormat format, VkDevice logicalDevi
     return imageView;
 }
 
-void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues)
+VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, VkDevice logicalDevice)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands(logicalDevice, commandPool);
+    return createImageView(image, format, aspectFlags, 0, mipLevels, logicalDevice);
+}
 
+VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkDevice logicalDevice)
+{
+    return createImageView(image, format, aspectFlags, 0, 1, logicalDevice);
+}
+
+VkImageView createImageView(VkImage image, VkFormat format, VkDevice logicalDevice)
+{
+    return createImageView(image, format, VK_IMAGE_ASPECT_COLOR_BIT, logicalDevice);
+}
+
+// first format of the candidates usable as depth attachment, depth only formats are preferred
+VkFormat findDepthFormat(VkPhysicalDevice physicalDevice)
+{
+    std::vector<VkFormat> candidates = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM};
+    for (auto format : candidates)
+    {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+        {
+            return format;
+        }
+    }
+    throw std::runtime_error("failed to find supported depth format!");
+}
+
+// records the barrier for the mip levels [baseMipLevel, baseMipLevel + levelCount)
+void recordLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t levelCount)
+{
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout = oldLayout;
@@ -36,8 +67,8 @@ void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayo
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image = image;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseMipLevel = baseMipLevel;
+    barrier.subresourceRange.levelCount = levelCount;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -60,6 +91,41 @@ void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayo
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
     }
+    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+    {
+        // a written mip level becomes the blit source of the next one
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+    {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+    else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+    {
+        // updating a texture that earlier frames sampled
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL)
+    {
+        // storage images, written by compute and read by compute or fragment shaders
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        destinationStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
     else
     {
         throw std::invalid_argument("unsupported layout transition!");
@@ -72,19 +138,33 @@ void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayo
         0, nullptr,
         0, nullptr,
         1, &barrier);
+}
 
+void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t levelCount, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues)
+{
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(logicalDevice, commandPool);
+    recordLayoutTransition(commandBuffer, image, oldLayout, newLayout, baseMipLevel, levelCount);
     endSingleTimeCommands(commandBuffer, queues, logicalDevice, commandPool);
 }
 
-void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory, VkDevice logicalDevice, VkPhysicalDevice physicalDevice)
+void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues)
+{
+    transitionImageLayout(image, format, oldLayout, newLayout, 0, 1, logicalDevice, commandPool, queues);
+}
+
+// like createBuffer, images used by more than one queue family are shared concurrently
+void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, std::vector<uint32_t> queueFamilies)
 {
+    std::sort(queueFamilies.begin(), queueFamilies.end());
+    queueFamilies.erase(std::unique(queueFamilies.begin(), queueFamilies.end()), queueFamilies.end());
+
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = format;
     imageInfo.tiling = tiling;
@@ -92,6 +172,12 @@ void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling
     imageInfo.usage = usage;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (queueFamilies.size() > 1)
+    {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+        imageInfo.pQueueFamilyIndices = queueFamilies.data();
+    }
 
     if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS)
     {
@@ -114,51 +200,194 @@ void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling
     vkBindImageMemory(logicalDevice, image, imageMemory, 0);
 }
 
-void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues)
+void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, std::vector<uint32_t> queueFamilies)
+{
+    createImage(width, height, 1, format, tiling, usage, properties, image, imageMemory, logicalDevice, physicalDevice, queueFamilies);
+}
+
+void copyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy> &regions, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues)
 {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands(logicalDevice, commandPool);
+    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+    endSingleTimeCommands(commandBuffer, queues, logicalDevice, commandPool);
+}
+
+VkBufferImageCopy mipCopyRegion(VkDeviceSize bufferOffset, uint32_t mipLevel, uint32_t width, uint32_t height)
+{
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
 
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.mipLevel = mipLevel;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = 1;
 
     region.imageOffset = {0, 0, 0};
     region.imageExtent = {width, height, 1};
-    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    return region;
+}
+
+void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues)
+{
+    copyBufferToImage(buffer, image, std::vector<VkBufferImageCopy>{mipCopyRegion(0, 0, width, height)}, logicalDevice, commandPool, queues);
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+    return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+// vkCmdBlitImage with linear filtering needs blit and filter support in optimal tiling
+bool checkLinearBlitSupport(VkFormat format, VkPhysicalDevice physicalDevice)
+{
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+// level 0 has to be in TRANSFER_DST_OPTIMAL, every level ends up in SHADER_READ_ONLY_OPTIMAL
+void generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues)
+{
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(logicalDevice, commandPool);
+    // a 1x1 image has no further levels, and a barrier over zero levels is invalid
+    if (mipLevels > 1)
+    {
+        recordLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, mipLevels - 1);
+    }
+
+    int32_t mipWidth = width;
+    int32_t mipHeight = height;
+    for (uint32_t i = 1; i < mipLevels; i++)
+    {
+        recordLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, i - 1, 1);
+
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = {0, 0, 0};
+        blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = i - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        mipWidth = std::max(mipWidth / 2, 1);
+        mipHeight = std::max(mipHeight / 2, 1);
+        blit.dstOffsets[0] = {0, 0, 0};
+        blit.dstOffsets[1] = {mipWidth, mipHeight, 1};
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = i;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        recordLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, i - 1, 1);
+    }
+    recordLayoutTransition(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels - 1, 1);
+
     endSingleTimeCommands(commandBuffer, queues, logicalDevice, commandPool);
 }
 
+float srgbToLinear(stbi_uc value)
+{
+    float c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+stbi_uc linearToSrgb(float value)
+{
+    float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<stbi_uc>(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// 2x2 box filter of RGBA8 sRGB texels, averaged in linear space like a blit would; odd edges clamp
+std::vector<stbi_uc> downsample(const std::vector<stbi_uc> &pixels, uint32_t width, uint32_t height)
+{
+    uint32_t halfWidth = std::max(width / 2, 1u);
+    uint32_t halfHeight = std::max(height / 2, 1u);
+    std::vector<stbi_uc> result(halfWidth * halfHeight * 4);
+    for (uint32_t y = 0; y < halfHeight; y++)
+    {
+        for (uint32_t x = 0; x < halfWidth; x++)
+        {
+            uint32_t x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            uint32_t y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            uint32_t texels[] = {(y0 * width + x0) * 4, (y0 * width + x1) * 4, (y1 * width + x0) * 4, (y1 * width + x1) * 4};
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                float sum = 0.0f;
+                for (auto texel : texels)
+                {
+                    sum += c == 3 ? pixels[texel + c] / 255.0f : srgbToLinear(pixels[texel + c]);
+                }
+                sum /= 4.0f;
+                result[(y * halfWidth + x) * 4 + c] = c == 3 ? static_cast<stbi_uc>(sum * 255.0f + 0.5f) : linearToSrgb(sum);
+            }
+        }
+    }
+    return result;
+}
+
+// uploads the full mip chain: blitted on the GPU if the format allows linear blits, otherwise downsampled on the CPU
 Texture createTextureImage(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueues queues, std::string name)
 {
     int texWidth, texHeight, texChannels;
     std::string path = "textures/" + name + ".png";
     stbi_uc *pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
 
     if (!pixels)
     {
         throw std::runtime_error("failed to load texture image!");
     }
 
+    uint32_t width = static_cast<uint32_t>(texWidth);
+    uint32_t height = static_cast<uint32_t>(texHeight);
+    uint32_t mipLevels = mipLevelCount(width, height);
+    bool blit = checkLinearBlitSupport(VK_FORMAT_R8G8B8A8_SRGB, physicalDevice);
+
+    std::vector<std::vector<stbi_uc>> levels;
+    levels.emplace_back(pixels, pixels + width * height * 4);
+    stbi_image_free(pixels);
+    std::vector<VkBufferImageCopy> regions{mipCopyRegion(0, 0, width, height)};
+    VkDeviceSize imageSize = levels[0].size();
+    if (!blit)
+    {
+        uint32_t mipWidth = width, mipHeight = height;
+        for (uint32_t i = 1; i < mipLevels; i++)
+        {
+            levels.push_back(downsample(levels.back(), mipWidth, mipHeight));
+            mipWidth = std::max(mipWidth / 2, 1u);
+            mipHeight = std::max(mipHeight / 2, 1u);
+            regions.push_back(mipCopyRegion(imageSize, i, mipWidth, mipHeight));
+            imageSize += levels.back().size();
+        }
+    }
+
     auto stagingBuffer = createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
 
     void *data;
     vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        memcpy((char *)data + regions[i].bufferOffset, levels[i].data(), levels[i].size());
+    }
     vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
 
-    stbi_image_free(pixels);
-
     Texture texture;
-    createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.textureImage, texture.textureImageMemory, logicalDevice, physicalDevice);
-    transitionImageLayout(texture.textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, logicalDevice, commandPool, queues);
-    copyBufferToImage(stagingBuffer.buffer, texture.textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), logicalDevice, commandPool, queues);
-    transitionImageLayout(texture.textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, logicalDevice, commandPool, queues);
+    texture.mipLevels = mipLevels;
+    createImage(width, height, mipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.textureImage, texture.textureImageMemory, logicalDevice, physicalDevice);
+    if (blit)
+    {
+        transitionImageLayout(texture.textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, 1, logicalDevice, commandPool, queues);
+        copyBufferToImage(stagingBuffer.buffer, texture.textureImage, regions, logicalDevice, commandPool, queues);
+        generateMipmaps(texture.textureImage, width, height, mipLevels, logicalDevice, commandPool, queues);
+    }
+    else
+    {
+        transitionImageLayout(texture.textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, mipLevels, logicalDevice, commandPool, queues);
+        copyBufferToImage(stagingBuffer.buffer, texture.textureImage, regions, logicalDevice, commandPool, queues);
+        transitionImageLayout(texture.textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, mipLevels, logicalDevice, commandPool, queues);
+    }
     vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
     vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
     return texture;
@@ -166,10 +395,11 @@ Texture createTextureImage(VkDevice logicalDevice, VkPhysicalDevice physicalDevi
 
 VkImageView createTextureImageView(Texture texture, VkDevice logicalDevice)
 {
-    return createImageView(texture.textureImage, VK_FORMAT_R8G8B8A8_SRGB, logicalDevice);
+    return createImageView(texture.textureImage, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels, logicalDevice);
 }
 
-VkSampler createTextureSampler(VkPhysicalDevice physicalDevice, VkDevice logicalDevice)
+// linear filtering over the full mip chain with the given anisotropy
+VkSamplerCreateInfo textureSamplerInfo(float maxAnisotropy)
 {
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -179,10 +409,7 @@ VkSampler createTextureSampler(VkPhysicalDevice physicalDevice, VkDevice logical
     samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = 2;
-    VkPhysicalDeviceProperties properties{};
-    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
-    samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+    samplerInfo.maxAnisotropy = maxAnisotropy;
     samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     samplerInfo.unnormalizedCoordinates = VK_FALSE;
     samplerInfo.compareEnable = VK_FALSE;
@@ -190,7 +417,15 @@ VkSampler createTextureSampler(VkPhysicalDevice physicalDevice, VkDevice logical
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    return samplerInfo;
+}
+
+VkSampler createTextureSampler(VkPhysicalDevice physicalDevice, VkDevice logicalDevice)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    auto samplerInfo = textureSamplerInfo(properties.limits.maxSamplerAnisotropy);
 
     VkSampler sampler;
     if (vkCreateSampler(logicalDevice, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
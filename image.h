@@ -4,7 +4,23 @@
 #include "common.cpp"
 
 VkImageView createImageView(VkImage image, VkFormat format, VkDevice logicalDevice);
+VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkDevice logicalDevice);
+VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, VkDevice logicalDevice);
+VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t baseMipLevel, uint32_t mipLevels, VkDevice logicalDevice);
+VkFormat findDepthFormat(VkPhysicalDevice physicalDevice);
+void recordLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t levelCount);
+void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues);
+void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t levelCount, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues);
+void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, std::vector<uint32_t> queueFamilies = {});
+void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, std::vector<uint32_t> queueFamilies = {});
+void copyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy> &regions, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues);
+VkBufferImageCopy mipCopyRegion(VkDeviceSize bufferOffset, uint32_t mipLevel, uint32_t width, uint32_t height);
+std::vector<stbi_uc> downsample(const std::vector<stbi_uc> &pixels, uint32_t width, uint32_t height);
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+bool checkLinearBlitSupport(VkFormat format, VkPhysicalDevice physicalDevice);
+void generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, VkDevice logicalDevice, VkCommandPool commandPool, VkQueues queues);
 Texture createTextureImage(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueues queues, std::string name);
+VkSamplerCreateInfo textureSamplerInfo(float maxAnisotropy);
 VkSampler createTextureSampler(VkPhysicalDevice physicalDevice, VkDevice logicalDevice);
 VkImageView createTextureImageView(Texture texture, VkDevice logicalDevice);
 
@@ -0,0 +1,433 @@
+#include "common.cpp"
+#include "jobSystem.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static const uint32_t NO_THREAD = UINT32_MAX;
+// times wait yields before it blocks on the counter
+static const uint32_t WAIT_YIELDS = 64;
+
+// which system the current thread belongs to and its index in it
+static thread_local const JobSystem *threadSystem = nullptr;
+static thread_local uint32_t threadIndex = NO_THREAD;
+// jobs run inside jobs through wait, only the outermost one counts as busy time
+static thread_local uint32_t jobDepth = 0;
+
+// pins the calling thread, only implemented on linux
+static void pinThread(uint32_t cpu)
+{
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+bool JobSystem::Deque::push(Job *job)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= static_cast<int64_t>(DEQUE_SIZE))
+    {
+        return false;
+    }
+    jobs[b % DEQUE_SIZE].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+// only the owning thread pops, it races the thieves for the last job
+Job *JobSystem::Deque::pop()
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+    if (t > b)
+    {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job *job = jobs[b % DEQUE_SIZE].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job *JobSystem::Deque::steal()
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+    {
+        return nullptr;
+    }
+    Job *job = jobs[t % DEQUE_SIZE].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return job;
+}
+
+void JobSystem::start(int amountWorkers, bool pinThreads)
+{
+    stopping = false;
+    threads.clear();
+    for (int i = 0; i <= amountWorkers; i++)
+    {
+        threads.push_back(std::make_unique<Thread>());
+    }
+    threadSystem = this;
+    threadIndex = 0;
+    if (pinThreads)
+    {
+        pinThread(0);
+    }
+    statisticsStart = std::chrono::high_resolution_clock::now();
+    for (int i = 1; i <= amountWorkers; i++)
+    {
+        threads[i]->thread = std::thread(&JobSystem::work, this, i, pinThreads);
+    }
+}
+
+uint32_t JobSystem::amountThreads() const
+{
+    return static_cast<uint32_t>(threads.size());
+}
+
+uint32_t JobSystem::currentThread() const
+{
+    return threadSystem == this ? threadIndex : NO_THREAD;
+}
+
+// whether the thread queues on its own deque and runs jobs while it waits
+bool JobSystem::helps(uint32_t thread) const
+{
+    return thread != NO_THREAD && (thread != 0 || amountThreads() == 1);
+}
+
+void JobSystem::run(std::function<void()> work, JobCounter *counter, JobCounter *dependency)
+{
+    Job *job = new Job{std::move(work), counter};
+    if (counter)
+    {
+        counter->pending.fetch_add(1);
+    }
+    if (dependency)
+    {
+        // finish decrements and takes the waiting jobs under the same lock
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (dependency->pending.load() > 0)
+        {
+            dependency->waiting.push_back(job);
+            std::lock_guard<std::mutex> dependencyLock(dependencyMutex);
+            dependencies.insert(dependency);
+            return;
+        }
+    }
+    schedule(job);
+}
+
+void JobSystem::schedule(Job *job)
+{
+    uint32_t thread = currentThread();
+    queuedJobs.fetch_add(1);
+    if (!helps(thread))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        injected.push_back(job);
+    }
+    else if (!threads[thread]->deque.push(job))
+    {
+        queuedJobs.fetch_sub(1);
+        execute(job, thread);
+        return;
+    }
+    if (sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        condition.notify_one();
+    }
+}
+
+// own deque first, it holds what this thread pushed last and is most likely still in its cache
+Job *JobSystem::find(uint32_t thread)
+{
+    if (queuedJobs.load(std::memory_order_relaxed) == 0)
+    {
+        return nullptr;
+    }
+    Job *job = nullptr;
+    if (thread != NO_THREAD)
+    {
+        job = threads[thread]->deque.pop();
+    }
+    if (!job)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!injected.empty())
+        {
+            job = injected.front();
+            injected.pop_front();
+        }
+    }
+    uint32_t amount = amountThreads();
+    for (uint32_t i = 1; !job && i <= amount; i++)
+    {
+        uint32_t victim = (thread == NO_THREAD ? 0 : thread) + i;
+        if (victim % amount == thread)
+        {
+            continue;
+        }
+        job = threads[victim % amount]->deque.steal();
+        if (job && thread != NO_THREAD)
+        {
+            threads[thread]->steals.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (job)
+    {
+        queuedJobs.fetch_sub(1);
+    }
+    return job;
+}
+
+void JobSystem::execute(Job *job, uint32_t thread)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    jobDepth++;
+    job->work();
+    jobDepth--;
+    if (thread != NO_THREAD)
+    {
+        auto &statistics = *threads[thread];
+        statistics.jobs.fetch_add(1, std::memory_order_relaxed);
+        if (jobDepth == 0)
+        {
+            auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+            statistics.busyNanoseconds.fetch_add(static_cast<uint64_t>(busy), std::memory_order_relaxed);
+        }
+    }
+    if (job->counter)
+    {
+        finish(job->counter);
+    }
+    delete job;
+}
+
+// decrements under the counter's lock, wait takes it once more so the counter isn't destroyed while still locked here
+void JobSystem::finish(JobCounter *counter)
+{
+    std::vector<Job *> released;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex);
+        if (counter->pending.fetch_sub(1) == 1)
+        {
+            released.swap(counter->waiting);
+            counter->finished.notify_all();
+            if (!released.empty())
+            {
+                std::lock_guard<std::mutex> dependencyLock(dependencyMutex);
+                dependencies.erase(counter);
+            }
+        }
+    }
+    for (Job *job : released)
+    {
+        schedule(job);
+    }
+}
+
+// threads outside the system help as well, they only take from the shared queue and steal. Once there is nothing
+// to help with the thread yields for a while, then blocks on the counter; the timeout lets it look for jobs again
+// that were queued meanwhile, nothing notifies a waiting thread about those
+void JobSystem::wait(JobCounter &counter)
+{
+    uint32_t thread = currentThread();
+    bool helping = thread == NO_THREAD || helps(thread);
+    uint32_t idle = 0;
+    while (counter.pending.load() > 0)
+    {
+        Job *job = helping ? find(thread) : nullptr;
+        if (job)
+        {
+            execute(job, thread);
+            idle = 0;
+        }
+        else if (++idle < WAIT_YIELDS)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(counter.mutex);
+            counter.finished.wait_for(lock, std::chrono::milliseconds(1), [&counter]
+                                      { return counter.pending.load() == 0; });
+        }
+    }
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+// every helper job keeps taking chunks until none are left, so uneven chunks balance out. Only the chunks are waited
+// for, not the helpers: one still queued behind other jobs finds nothing left once it runs and returns right away
+void JobSystem::parallelFor(uint32_t begin, uint32_t end, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)> &job)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+    uint32_t amountChunks = (end - begin + chunkSize - 1) / chunkSize;
+    if (amountChunks == 1 || amountThreads() <= 1)
+    {
+        job(begin, end);
+        return;
+    }
+    // shared with the helpers, which may outlive this call
+    struct Range
+    {
+        std::atomic<uint32_t> next;
+        JobCounter chunksLeft;
+        const std::function<void(uint32_t, uint32_t)> *job;
+    };
+    auto range = std::make_shared<Range>();
+    range->next = begin;
+    range->chunksLeft.pending = amountChunks;
+    range->job = &job;
+    auto chunks = [this, range, end, chunkSize]()
+    {
+        while (true)
+        {
+            uint32_t first = range->next.fetch_add(chunkSize);
+            if (first >= end)
+            {
+                return;
+            }
+            (*range->job)(first, first + std::min(chunkSize, end - first));
+            finish(&range->chunksLeft);
+        }
+    };
+    uint32_t helpers = std::min(amountChunks, amountThreads()) - 1;
+    for (uint32_t i = 0; i < helpers; i++)
+    {
+        run(chunks);
+    }
+    chunks();
+    wait(range->chunksLeft);
+}
+
+std::vector<WorkerStatistics> JobSystem::statistics()
+{
+    auto now = std::chrono::high_resolution_clock::now();
+    double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - statisticsStart).count());
+    statisticsStart = now;
+    std::vector<WorkerStatistics> result;
+    for (auto &thread : threads)
+    {
+        WorkerStatistics statistics;
+        statistics.utilization = elapsed > 0.0 ? static_cast<float>(thread->busyNanoseconds.exchange(0) / elapsed) : 0.0f;
+        statistics.jobs = thread->jobs.exchange(0);
+        statistics.steals = thread->steals.exchange(0);
+        result.push_back(statistics);
+    }
+    return result;
+}
+
+void JobSystem::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (size_t i = 1; i < threads.size(); i++)
+    {
+        threads[i]->thread.join();
+    }
+    // whatever thread 0 queued itself and nobody stole. Then every job still waiting for a dependency is dropped, which
+    // includes the ones depending on a dropped job; their counters are finished so threads in wait return
+    while (true)
+    {
+        while (Job *job = find(0))
+        {
+            execute(job, 0);
+        }
+        std::set<JobCounter *> blocked;
+        {
+            std::lock_guard<std::mutex> lock(dependencyMutex);
+            blocked.swap(dependencies);
+        }
+        std::vector<Job *> dropped;
+        for (JobCounter *dependency : blocked)
+        {
+            std::lock_guard<std::mutex> lock(dependency->mutex);
+            dropped.insert(dropped.end(), dependency->waiting.begin(), dependency->waiting.end());
+            dependency->waiting.clear();
+        }
+        if (dropped.empty())
+        {
+            break;
+        }
+        for (Job *job : dropped)
+        {
+            if (job->counter)
+            {
+                finish(job->counter);
+            }
+            delete job;
+        }
+    }
+    threads.clear();
+    if (threadSystem == this)
+    {
+        threadSystem = nullptr;
+        threadIndex = NO_THREAD;
+    }
+}
+
+void JobSystem::work(uint32_t thread, bool pin)
+{
+    threadSystem = this;
+    threadIndex = thread;
+    if (pin)
+    {
+        pinThread(thread);
+    }
+    while (true)
+    {
+        Job *job = find(thread);
+        if (job)
+        {
+            execute(job, thread);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stopping && queuedJobs.load() == 0)
+        {
+            return;
+        }
+        // a job can be counted before it is pushed, or sit in a deque whose owner is busy; try again then
+        if (queuedJobs.load() > 0)
+        {
+            lock.unlock();
+            std::this_thread::yield();
+            continue;
+        }
+        sleeping.fetch_add(1);
+        condition.wait(lock, [this]
+                       { return stopping || queuedJobs.load() > 0; });
+        sleeping.fetch_sub(1);
+    }
+}
\ No newline at end of file
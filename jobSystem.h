@@ -0,0 +1,107 @@
+#ifndef job_system_h
+#define job_system_h
+
+#include "common.cpp"
+
+struct JobCounter;
+
+struct Job
+{
+    std::function<void()> work;
+    JobCounter *counter;
+};
+
+// counts unfinished jobs, see JobSystem::run; has to outlive the jobs it counts and the jobs waiting for it
+struct JobCounter
+{
+    std::atomic<uint32_t> pending{0};
+    // jobs that start once pending reaches zero
+    std::mutex mutex;
+    std::vector<Job *> waiting;
+    // notified when pending reaches zero, for threads in JobSystem::wait that ran out of jobs to help with
+    std::condition_variable finished;
+};
+
+struct WorkerStatistics
+{
+    // fraction of the time since the previous JobSystem::statistics spent running jobs
+    float utilization;
+    uint64_t jobs;
+    // jobs taken from another thread's deque
+    uint64_t steals;
+};
+
+// work stealing scheduler, every thread pushes and pops jobs at the bottom of its own lock-free deque
+// while idle threads steal from the top of the others'. Thread 0 is the render thread: as long as there are workers
+// its jobs go to the shared queue and it never runs other jobs while it waits, so a long job can't stall a frame
+class JobSystem
+{
+public:
+    // jobs per deque, a job that doesn't fit runs right away
+    static constexpr uint32_t DEQUE_SIZE = 4096;
+
+    // the calling thread becomes thread 0, it runs jobs while it waits; pinning puts thread i on cpu i
+    void start(int amountWorkers, bool pinThreads = false);
+    // counter is incremented now and decremented once the job finished, the job only starts
+    // after dependency reached zero; both may be null
+    void run(std::function<void()> work, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+    // runs other jobs until the counter reaches zero, thread 0 only does so without workers
+    void wait(JobCounter &counter);
+    // job is called with consecutive ranges of at most chunkSize indices, returns once all of them are done
+    void parallelFor(uint32_t begin, uint32_t end, uint32_t chunkSize, const std::function<void(uint32_t, uint32_t)> &job);
+    uint32_t amountThreads() const;
+    // per thread, thread 0 first; resets the statistics
+    std::vector<WorkerStatistics> statistics();
+    // finishes every queued job, then joins the workers; jobs whose dependency never reached zero are dropped
+    // without running (and so are jobs depending on them), their counters are still decremented so nobody waits
+    // on them forever
+    void stop();
+
+private:
+    // Chase-Lev deque with a fixed size ring
+    class Deque
+    {
+    public:
+        bool push(Job *job);
+        Job *pop();
+        Job *steal();
+
+    private:
+        std::atomic<int64_t> top{0};
+        std::atomic<int64_t> bottom{0};
+        std::array<std::atomic<Job *>, DEQUE_SIZE> jobs;
+    };
+
+    struct Thread
+    {
+        Deque deque;
+        std::thread thread;
+        std::atomic<uint64_t> busyNanoseconds{0};
+        std::atomic<uint64_t> jobs{0};
+        std::atomic<uint64_t> steals{0};
+    };
+
+    std::vector<std::unique_ptr<Thread>> threads;
+    // jobs run from threads outside the system and from thread 0
+    std::deque<Job *> injected;
+    std::mutex mutex;
+    std::condition_variable condition;
+    // in deques or injected, jobs waiting for a dependency don't count
+    std::atomic<uint32_t> queuedJobs{0};
+    std::atomic<uint32_t> sleeping{0};
+    // counters with jobs waiting for them, only taken while holding the counter's lock
+    std::mutex dependencyMutex;
+    std::set<JobCounter *> dependencies;
+    bool stopping = false;
+    std::chrono::high_resolution_clock::time_point statisticsStart;
+
+    uint32_t currentThread() const;
+    bool helps(uint32_t thread) const;
+    void schedule(Job *job);
+    Job *find(uint32_t thread);
+    void execute(Job *job, uint32_t thread);
+    void finish(JobCounter *counter);
+    void work(uint32_t thread, bool pin);
+};
+
+#endif
\ No newline at end of file
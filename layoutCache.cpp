@@ -0,0 +1,169 @@
+#include "common.cpp"
+#include "layoutCache.h"
+
+bool LayoutCache::SetLayoutKey::operator==(const SetLayoutKey &other) const
+{
+    if (bindings.size() != other.bindings.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        auto &a = bindings[i];
+        auto &b = other.bindings[i];
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t LayoutCache::SetLayoutKeyHash::operator()(const SetLayoutKey &key) const
+{
+    size_t seed = key.bindings.size();
+    for (auto &binding : key.bindings)
+    {
+        hashCombine(seed, binding.binding);
+        hashCombine(seed, binding.descriptorType);
+        hashCombine(seed, binding.descriptorCount);
+        hashCombine(seed, binding.stageFlags);
+    }
+    return seed;
+}
+
+bool LayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey &other) const
+{
+    if (setLayouts != other.setLayouts || pushConstants.size() != other.pushConstants.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < pushConstants.size(); i++)
+    {
+        auto &a = pushConstants[i];
+        auto &b = other.pushConstants[i];
+        if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t LayoutCache::PipelineLayoutKeyHash::operator()(const PipelineLayoutKey &key) const
+{
+    size_t seed = key.setLayouts.size();
+    for (auto setLayout : key.setLayouts)
+    {
+        hashCombine(seed, std::hash<const void *>{}(setLayout));
+    }
+    for (auto &range : key.pushConstants)
+    {
+        hashCombine(seed, range.stageFlags);
+        hashCombine(seed, range.offset);
+        hashCombine(seed, range.size);
+    }
+    return seed;
+}
+
+void LayoutCache::init(VkDevice logicalDevice)
+{
+    this->logicalDevice = logicalDevice;
+}
+
+VkDescriptorSetLayout LayoutCache::getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings)
+{
+    // binding order does not change the layout
+    std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b)
+              { return a.binding < b.binding; });
+    SetLayoutKey key{bindings};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto cached = setLayouts.find(key);
+    if (cached != setLayouts.end())
+    {
+        return cached->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+    setLayouts[key] = layout;
+    layoutBindings[layout] = bindings;
+    return layout;
+}
+
+// exactly the descriptors amountSets sets of this layout need, for pools that have to fit one specific layout
+std::vector<VkDescriptorPoolSize> LayoutCache::getPoolSizes(VkDescriptorSetLayout layout, uint32_t amountSets)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto cached = layoutBindings.find(layout);
+    if (cached == layoutBindings.end())
+    {
+        throw std::runtime_error("descriptor set layout was not created by the layout cache!");
+    }
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (auto &binding : cached->second)
+    {
+        auto size = std::find_if(poolSizes.begin(), poolSizes.end(), [&](const VkDescriptorPoolSize &x)
+                                 { return x.type == binding.descriptorType; });
+        if (size == poolSizes.end())
+        {
+            poolSizes.push_back({binding.descriptorType, 0});
+            size = poolSizes.end() - 1;
+        }
+        size->descriptorCount += binding.descriptorCount * amountSets;
+    }
+    return poolSizes;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(std::vector<VkDescriptorSetLayout> setLayouts, std::vector<VkPushConstantRange> pushConstants)
+{
+    PipelineLayoutKey key{setLayouts, pushConstants};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto cached = pipelineLayouts.find(key);
+    if (cached != pipelineLayouts.end())
+    {
+        return cached->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstants.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
+
+    VkPipelineLayout pipelineLayout;
+    if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline layout");
+    }
+    pipelineLayouts[key] = pipelineLayout;
+    return pipelineLayout;
+}
+
+void LayoutCache::destroy()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &x : pipelineLayouts)
+    {
+        vkDestroyPipelineLayout(logicalDevice, x.second, nullptr);
+    }
+    for (auto &x : setLayouts)
+    {
+        vkDestroyDescriptorSetLayout(logicalDevice, x.second, nullptr);
+    }
+    pipelineLayouts.clear();
+    setLayouts.clear();
+    layoutBindings.clear();
+}
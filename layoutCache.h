@@ -0,0 +1,44 @@
+#ifndef layout_cache_h
+#define layout_cache_h
+
+#include "common.cpp"
+
+// deduplicates descriptor set layouts and pipeline layouts, identical requests share one handle
+class LayoutCache
+{
+public:
+    void init(VkDevice logicalDevice);
+    VkDescriptorSetLayout getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+    VkPipelineLayout getPipelineLayout(std::vector<VkDescriptorSetLayout> setLayouts, std::vector<VkPushConstantRange> pushConstants);
+    std::vector<VkDescriptorPoolSize> getPoolSizes(VkDescriptorSetLayout layout, uint32_t amountSets);
+    void destroy();
+
+private:
+    struct SetLayoutKey
+    {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        bool operator==(const SetLayoutKey &other) const;
+    };
+    struct SetLayoutKeyHash
+    {
+        size_t operator()(const SetLayoutKey &key) const;
+    };
+    struct PipelineLayoutKey
+    {
+        std::vector<VkDescriptorSetLayout> setLayouts;
+        std::vector<VkPushConstantRange> pushConstants;
+        bool operator==(const PipelineLayoutKey &other) const;
+    };
+    struct PipelineLayoutKeyHash
+    {
+        size_t operator()(const PipelineLayoutKey &key) const;
+    };
+
+    VkDevice logicalDevice;
+    std::mutex mutex;
+    std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, SetLayoutKeyHash> setLayouts;
+    std::unordered_map<PipelineLayoutKey, VkPipelineLayout, PipelineLayoutKeyHash> pipelineLayouts;
+    std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSetLayoutBinding>> layoutBindings;
+};
+
+#endif
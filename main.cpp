@@ -15,12 +15,15 @@ class Main
 {
 public:
     Vesuv vesuv;
-    GraphicsPipeline graphicsPipeline;
+    PipelineHandle graphicsPipeline;
     Buffer vertexBuffer;
     Buffer indexBuffer;
     Buffer VBO2;
     Texture texture;
     VkSampler textureSampler;
+    SceneTransforms scene;
+    uint32_t quadNode;
+    uint32_t triNode;
 
     void updateUniformBuffer(Uniforms &uniforms, uint32_t currentImage)
     {
@@ -29,6 +32,7 @@ public:
         float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
         UniformBufferObject ubo{};
 
+        // shader/scene.vert takes the model matrices from the scene transforms
         ubo.model = glm::mat4(1.0f);
         // ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
         //   ubo.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
@@ -43,14 +47,14 @@ public:
     Main()
     {
         this->texture = vesuv.createTexture("statue");
-        this->textureSampler = createTextureSampler(vesuv.physicalDevice, vesuv.logicalDevice);
+        this->textureSampler = vesuv.createSampler();
 
-        auto uniforms = vesuv.createUniforms(std::vector<VkDescriptorType>{
-                                                 VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                                                 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                             },
-                                             1, texture, textureSampler);
-        this->graphicsPipeline = vesuv.createGraphicPipeline(uniforms.descriptorSetLayout, "tri");
+        this->scene = vesuv.createSceneTransforms(2);
+        this->quadNode = scene.create();
+        this->triNode = scene.create(quadNode);
+
+        auto uniforms = vesuv.createSceneUniforms(scene, texture, textureSampler);
+        this->graphicsPipeline = vesuv.compileGraphicPipeline(uniforms.descriptorSetLayout, "scene");
         graphicsPipeline.uniforms = std::vector<Uniforms>{uniforms, uniforms};
         this->vertexBuffer = vesuv.createVBO(quadVertices);
         this->VBO2 = vesuv.createVBO(triVertices);
@@ -69,13 +73,20 @@ public:
 
             if (elapsed >= 1.0f)
             {
-                printf("drawn %d frames in 1 second\n", frameCount);
+                printf("drawn %d frames in 1 second, %llu triangles per frame (%llu without LOD)\n", frameCount, (unsigned long long)vesuv.submittedTriangles, (unsigned long long)vesuv.fullDetailTriangles);
+                auto threads = vesuv.jobSystem.statistics();
+                for (size_t i = 0; i < threads.size(); i++)
+                {
+                    printf("  job thread %zu: %.0f%% busy, %llu jobs, %llu stolen\n", i, threads[i].utilization * 100.0f, (unsigned long long)threads[i].jobs, (unsigned long long)threads[i].steals);
+                }
                 elapsed = 0;
                 frameCount = 0;
             }
-            vesuv.drawFrame(std::vector<Buffer>{vertexBuffer, VBO2}, std::vector<Buffer>{indexBuffer, indexBuffer}, graphicsPipeline);
+            // scene.setRotation(quadNode, glm::vec4(0.0f, 0.0f, sin(curr * glm::radians(45.0)), cos(curr * glm::radians(45.0))));
+            vesuv.updateSceneTransforms(scene);
+            vesuv.drawFrame(std::vector<Buffer>{vertexBuffer, VBO2}, std::vector<Buffer>{indexBuffer, indexBuffer}, graphicsPipeline, GraphicsPipeline{}, std::vector<uint32_t>{quadNode, triNode});
+            // both objects share the uniforms, only view and projection are left in them
             updateUniformBuffer(graphicsPipeline.uniforms[0], vesuv.currentFrame);
-            updateUniformBuffer(graphicsPipeline.uniforms[1], vesuv.currentFrame);
 
             if (glfwGetKey(this->vesuv.window.window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
             {
@@ -89,6 +100,7 @@ public:
         vesuv.destroySampler(textureSampler);
         vesuv.destroyPipeline(graphicsPipeline);
         vesuv.destroyUniforms(uniforms);
+        vesuv.destroySceneTransforms(scene);
         vesuv.destroyBuffer(VBO2);
         vesuv.destroyBuffer(indexBuffer);
         vesuv.destroyBuffer(vertexBuffer);
@@ -0,0 +1,1253 @@
+#include "common.cpp"
+#include "vertex.h"
+#include "mesh.h"
+
+static std::vector<uint8_t> readMeshFile(std::string path)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open mesh file " + path);
+    }
+    std::vector<uint8_t> buffer(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+    return buffer;
+}
+
+static glm::vec3 faceNormal(glm::vec3 a, glm::vec3 b, glm::vec3 c)
+{
+    auto normal = glm::cross(b - a, c - a);
+    float length = glm::length(normal);
+    return length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+// obj indices start at 1, negative ones count back from the last element read so far
+static uint32_t objIndex(long index, size_t size)
+{
+    long resolved = index > 0 ? index - 1 : static_cast<long>(size) + index;
+    if (index == 0 || resolved < 0 || resolved >= static_cast<long>(size))
+    {
+        throw std::runtime_error("invalid index in obj file!");
+    }
+    return static_cast<uint32_t>(resolved);
+}
+
+// every face corner becomes its own vertex, deduplicateVertices merges them again
+MeshData loadObj(std::string path)
+{
+    auto file = readMeshFile(path);
+    file.push_back('\0');
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    MeshData mesh;
+
+    const char *cursor = reinterpret_cast<const char *>(file.data());
+    while (*cursor)
+    {
+        const char *lineEnd = cursor;
+        while (*lineEnd && *lineEnd != '\n')
+        {
+            lineEnd++;
+        }
+        std::string line(cursor, lineEnd);
+        cursor = *lineEnd ? lineEnd + 1 : lineEnd;
+
+        const char *p = line.c_str();
+        if (line.compare(0, 2, "v ") == 0)
+        {
+            glm::vec3 position{};
+            sscanf(p + 2, "%f %f %f", &position.x, &position.y, &position.z);
+            positions.push_back(position);
+        }
+        else if (line.compare(0, 3, "vn ") == 0)
+        {
+            glm::vec3 normal{};
+            sscanf(p + 3, "%f %f %f", &normal.x, &normal.y, &normal.z);
+            normals.push_back(normal);
+        }
+        else if (line.compare(0, 3, "vt ") == 0)
+        {
+            glm::vec2 texCoord{};
+            sscanf(p + 3, "%f %f", &texCoord.x, &texCoord.y);
+            // obj has its texture origin at the bottom left
+            texCoord.y = 1.0f - texCoord.y;
+            texCoords.push_back(texCoord);
+        }
+        else if (line.compare(0, 2, "f ") == 0)
+        {
+            std::vector<MeshVertex> corners;
+            bool hasNormals = true;
+            p += 2;
+            while (true)
+            {
+                char *next;
+                long position = strtol(p, &next, 10);
+                if (next == p)
+                {
+                    break;
+                }
+                p = next;
+                MeshVertex vertex{};
+                vertex.pos = positions[objIndex(position, positions.size())];
+                bool normal = false;
+                if (*p == '/')
+                {
+                    p++;
+                    if (*p != '/')
+                    {
+                        vertex.texCoord = texCoords[objIndex(strtol(p, &next, 10), texCoords.size())];
+                        p = next;
+                    }
+                    if (*p == '/')
+                    {
+                        p++;
+                        vertex.normal = normals[objIndex(strtol(p, &next, 10), normals.size())];
+                        p = next;
+                        normal = true;
+                    }
+                }
+                hasNormals = hasNormals && normal;
+                corners.push_back(vertex);
+            }
+            if (corners.size() < 3)
+            {
+                throw std::runtime_error("face with less than three corners in obj file!");
+            }
+            if (!hasNormals)
+            {
+                mesh.faceNormals = true;
+                auto normal = faceNormal(corners[0].pos, corners[1].pos, corners[2].pos);
+                for (auto &corner : corners)
+                {
+                    corner.normal = normal;
+                }
+            }
+            // polygons are triangulated as a fan around the first corner
+            for (size_t i = 1; i + 1 < corners.size(); i++)
+            {
+                for (auto corner : {corners[0], corners[i], corners[i + 1]})
+                {
+                    mesh.indices.push_back(static_cast<uint32_t>(mesh.vertices.size()));
+                    mesh.vertices.push_back(corner);
+                }
+            }
+        }
+    }
+    return mesh;
+}
+
+// just enough json for the glTF scene description
+struct JsonValue
+{
+    double number = 0.0;
+    std::string string;
+    // keys are only set for objects, arrays leave them empty
+    std::vector<std::string> keys;
+    std::vector<JsonValue> values;
+
+    const JsonValue *find(const std::string &key) const
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (keys[i] == key)
+            {
+                return &values[i];
+            }
+        }
+        return nullptr;
+    }
+
+    const JsonValue &at(const std::string &key) const
+    {
+        auto value = find(key);
+        if (value == nullptr)
+        {
+            throw std::runtime_error("glTF is missing " + key + "!");
+        }
+        return *value;
+    }
+
+    const JsonValue &at(size_t index) const
+    {
+        if (index >= values.size())
+        {
+            throw std::runtime_error("glTF index out of range!");
+        }
+        return values[index];
+    }
+
+    uint32_t integer(const std::string &key, uint32_t fallback) const
+    {
+        auto value = find(key);
+        return value ? static_cast<uint32_t>(value->number) : fallback;
+    }
+};
+
+static void skipWhitespace(const char *&p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    {
+        p++;
+    }
+}
+
+static std::string parseJsonString(const char *&p, const char *end)
+{
+    std::string string;
+    p++;
+    while (p < end && *p != '"')
+    {
+        if (*p == '\\' && p + 1 < end)
+        {
+            p++;
+            switch (*p)
+            {
+            case 'n':
+                string += '\n';
+                break;
+            case 't':
+                string += '\t';
+                break;
+            case 'r':
+                string += '\r';
+                break;
+            case 'b':
+                string += '\b';
+                break;
+            case 'f':
+                string += '\f';
+                break;
+            case 'u':
+                // names and uris are all the loader reads, escaped code points are not needed
+                string += '?';
+                p += std::min<ptrdiff_t>(4, end - p - 1);
+                break;
+            default:
+                string += *p;
+            }
+        }
+        else
+        {
+            string += *p;
+        }
+        p++;
+    }
+    if (p >= end)
+    {
+        throw std::runtime_error("unterminated string in glTF!");
+    }
+    p++;
+    return string;
+}
+
+static JsonValue parseJson(const char *&p, const char *end)
+{
+    skipWhitespace(p, end);
+    if (p >= end)
+    {
+        throw std::runtime_error("unexpected end of glTF!");
+    }
+    JsonValue value;
+    if (*p == '{' || *p == '[')
+    {
+        bool object = *p == '{';
+        char close = object ? '}' : ']';
+        p++;
+        skipWhitespace(p, end);
+        while (p < end && *p != close)
+        {
+            if (object)
+            {
+                if (*p != '"')
+                {
+                    throw std::runtime_error("malformed glTF object!");
+                }
+                value.keys.push_back(parseJsonString(p, end));
+                skipWhitespace(p, end);
+                if (p >= end || *p != ':')
+                {
+                    throw std::runtime_error("malformed glTF object!");
+                }
+                p++;
+            }
+            value.values.push_back(parseJson(p, end));
+            skipWhitespace(p, end);
+            if (p < end && *p == ',')
+            {
+                p++;
+                skipWhitespace(p, end);
+            }
+        }
+        if (p >= end)
+        {
+            throw std::runtime_error("unexpected end of glTF!");
+        }
+        p++;
+    }
+    else if (*p == '"')
+    {
+        value.string = parseJsonString(p, end);
+    }
+    else if (*p == 't' || *p == 'f' || *p == 'n')
+    {
+        value.number = *p == 't' ? 1.0 : 0.0;
+        while (p < end && isalpha(static_cast<unsigned char>(*p)))
+        {
+            p++;
+        }
+    }
+    else
+    {
+        char *next;
+        value.number = strtod(p, &next);
+        if (next == p)
+        {
+            throw std::runtime_error("malformed glTF value!");
+        }
+        p = next;
+    }
+    return value;
+}
+
+const uint32_t GLB_MAGIC = 0x46546C67;
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+struct Accessor
+{
+    const uint8_t *data;
+    size_t count;
+    uint32_t componentType;
+    uint32_t components;
+    size_t stride;
+    bool normalized;
+};
+
+static uint32_t componentSize(uint32_t componentType)
+{
+    switch (componentType)
+    {
+    case 5120:
+    case 5121:
+        return 1;
+    case 5122:
+    case 5123:
+        return 2;
+    case 5125:
+    case 5126:
+        return 4;
+    default:
+        throw std::runtime_error("unsupported glTF component type!");
+    }
+}
+
+static Accessor readAccessor(const JsonValue &gltf, const std::vector<uint8_t> &bin, uint32_t index)
+{
+    auto &accessor = gltf.at("accessors").at(index);
+    if (accessor.find("sparse") || !accessor.find("bufferView"))
+    {
+        throw std::runtime_error("sparse glTF accessors are not supported!");
+    }
+    auto &view = gltf.at("bufferViews").at(accessor.integer("bufferView", 0));
+    if (view.integer("buffer", 0) != 0)
+    {
+        throw std::runtime_error("glTF data outside of the glb binary chunk is not supported!");
+    }
+
+    std::string type = accessor.at("type").string;
+    Accessor result;
+    result.count = accessor.integer("count", 0);
+    result.componentType = accessor.integer("componentType", 0);
+    result.components = type == "SCALAR" ? 1 : type == "VEC2" ? 2
+                                           : type == "VEC3"   ? 3
+                                           : type == "VEC4"   ? 4
+                                                              : 0;
+    if (result.components == 0)
+    {
+        throw std::runtime_error("unsupported glTF accessor type " + type);
+    }
+    size_t elementSize = componentSize(result.componentType) * result.components;
+    result.stride = view.integer("byteStride", static_cast<uint32_t>(elementSize));
+    result.normalized = accessor.find("normalized") && accessor.at("normalized").number != 0.0;
+
+    size_t offset = static_cast<size_t>(view.integer("byteOffset", 0)) + accessor.integer("byteOffset", 0);
+    size_t length = view.integer("byteLength", 0);
+    if (result.count != 0 && (offset + (result.count - 1) * result.stride + elementSize > bin.size() ||
+                              accessor.integer("byteOffset", 0) + (result.count - 1) * result.stride + elementSize > length))
+    {
+        throw std::runtime_error("glTF accessor exceeds its buffer!");
+    }
+    result.data = bin.data() + offset;
+    return result;
+}
+
+static float readComponent(const Accessor &accessor, size_t element, uint32_t component)
+{
+    const uint8_t *p = accessor.data + element * accessor.stride + component * componentSize(accessor.componentType);
+    switch (accessor.componentType)
+    {
+    case 5126:
+    {
+        float value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    case 5121:
+        return accessor.normalized ? *p / 255.0f : *p;
+    case 5120:
+    {
+        int8_t value = static_cast<int8_t>(*p);
+        return accessor.normalized ? std::max(value / 127.0f, -1.0f) : value;
+    }
+    case 5123:
+    {
+        uint16_t value;
+        memcpy(&value, p, sizeof(value));
+        return accessor.normalized ? value / 65535.0f : value;
+    }
+    case 5122:
+    {
+        int16_t value;
+        memcpy(&value, p, sizeof(value));
+        return accessor.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+    }
+    default:
+        throw std::runtime_error("unsupported glTF vertex component type!");
+    }
+}
+
+static uint32_t readIndex(const Accessor &accessor, size_t element)
+{
+    const uint8_t *p = accessor.data + element * accessor.stride;
+    switch (accessor.componentType)
+    {
+    case 5121:
+        return *p;
+    case 5123:
+    {
+        uint16_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    case 5125:
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+    default:
+        throw std::runtime_error("unsupported glTF index type!");
+    }
+}
+
+// binary glTF 2.0, the triangle primitives of all meshes are merged into one,
+// node transforms are not applied
+MeshData loadGlb(std::string path)
+{
+    auto file = readMeshFile(path);
+    uint32_t header[3];
+    if (file.size() < sizeof(header))
+    {
+        throw std::runtime_error("truncated glb file!");
+    }
+    memcpy(header, file.data(), sizeof(header));
+    if (header[0] != GLB_MAGIC || header[1] != 2)
+    {
+        throw std::runtime_error("not a glTF 2.0 binary file: " + path);
+    }
+
+    JsonValue gltf;
+    bool hasJson = false;
+    std::vector<uint8_t> bin;
+    size_t offset = sizeof(header);
+    while (offset + 8 <= file.size())
+    {
+        uint32_t chunk[2];
+        memcpy(chunk, file.data() + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+        if (offset + chunk[0] > file.size())
+        {
+            throw std::runtime_error("truncated glb chunk!");
+        }
+        const char *begin = reinterpret_cast<const char *>(file.data() + offset);
+        if (chunk[1] == GLB_CHUNK_JSON)
+        {
+            gltf = parseJson(begin, begin + chunk[0]);
+            hasJson = true;
+        }
+        else if (chunk[1] == GLB_CHUNK_BIN && bin.empty())
+        {
+            bin.assign(file.data() + offset, file.data() + offset + chunk[0]);
+        }
+        // chunks are padded to four bytes
+        offset += (chunk[0] + 3) & ~3u;
+    }
+    if (!hasJson)
+    {
+        throw std::runtime_error("glb file without json chunk!");
+    }
+
+    MeshData mesh;
+    auto meshes = gltf.find("meshes");
+    if (meshes == nullptr)
+    {
+        return mesh;
+    }
+    for (auto &gltfMesh : meshes->values)
+    {
+        for (auto &primitive : gltfMesh.at("primitives").values)
+        {
+            // 4 is a triangle list
+            if (primitive.integer("mode", 4) != 4)
+            {
+                continue;
+            }
+            auto &attributes = primitive.at("attributes");
+            auto positions = readAccessor(gltf, bin, attributes.integer("POSITION", 0));
+            uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+            mesh.vertices.resize(base + positions.count);
+            for (size_t i = 0; i < positions.count; i++)
+            {
+                mesh.vertices[base + i].pos = glm::vec3(readComponent(positions, i, 0), readComponent(positions, i, 1), readComponent(positions, i, 2));
+            }
+            if (attributes.find("TEXCOORD_0"))
+            {
+                auto texCoords = readAccessor(gltf, bin, attributes.integer("TEXCOORD_0", 0));
+                for (size_t i = 0; i < std::min(texCoords.count, positions.count); i++)
+                {
+                    mesh.vertices[base + i].texCoord = glm::vec2(readComponent(texCoords, i, 0), readComponent(texCoords, i, 1));
+                }
+            }
+
+            size_t firstIndex = mesh.indices.size();
+            if (primitive.find("indices"))
+            {
+                auto indices = readAccessor(gltf, bin, primitive.integer("indices", 0));
+                for (size_t i = 0; i < indices.count; i++)
+                {
+                    uint32_t index = readIndex(indices, i);
+                    if (index >= positions.count)
+                    {
+                        throw std::runtime_error("glTF index out of range!");
+                    }
+                    mesh.indices.push_back(base + index);
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < positions.count; i++)
+                {
+                    mesh.indices.push_back(base + static_cast<uint32_t>(i));
+                }
+            }
+            mesh.indices.resize(firstIndex + (mesh.indices.size() - firstIndex) / 3 * 3);
+
+            if (attributes.find("NORMAL"))
+            {
+                auto normals = readAccessor(gltf, bin, attributes.integer("NORMAL", 0));
+                for (size_t i = 0; i < std::min(normals.count, positions.count); i++)
+                {
+                    mesh.vertices[base + i].normal = glm::vec3(readComponent(normals, i, 0), readComponent(normals, i, 1), readComponent(normals, i, 2));
+                }
+            }
+            else
+            {
+                // smooth normals, weighted by triangle area
+                for (size_t i = firstIndex; i < mesh.indices.size(); i += 3)
+                {
+                    auto &a = mesh.vertices[mesh.indices[i]];
+                    auto &b = mesh.vertices[mesh.indices[i + 1]];
+                    auto &c = mesh.vertices[mesh.indices[i + 2]];
+                    auto normal = glm::cross(b.pos - a.pos, c.pos - a.pos);
+                    a.normal += normal;
+                    b.normal += normal;
+                    c.normal += normal;
+                }
+                for (size_t i = base; i < mesh.vertices.size(); i++)
+                {
+                    float length = glm::length(mesh.vertices[i].normal);
+                    mesh.vertices[i].normal = length > 0.0f ? mesh.vertices[i].normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                }
+            }
+        }
+    }
+    return mesh;
+}
+
+struct MeshVertexHash
+{
+    size_t operator()(const MeshVertex &vertex) const
+    {
+        uint32_t words[sizeof(MeshVertex) / sizeof(uint32_t)];
+        memcpy(words, &vertex, sizeof(words));
+        size_t seed = 0;
+        for (auto word : words)
+        {
+            hashCombine(seed, word);
+        }
+        return seed;
+    }
+};
+
+struct MeshVertexEqual
+{
+    bool operator()(const MeshVertex &a, const MeshVertex &b) const
+    {
+        return memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+    }
+};
+
+// bitwise identical vertices are merged
+void deduplicateVertices(MeshData &mesh)
+{
+    std::unordered_map<MeshVertex, uint32_t, MeshVertexHash, MeshVertexEqual> unique;
+    unique.reserve(mesh.vertices.size());
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> remap(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        auto inserted = unique.emplace(mesh.vertices[i], static_cast<uint32_t>(vertices.size()));
+        if (inserted.second)
+        {
+            vertices.push_back(mesh.vertices[i]);
+        }
+        remap[i] = inserted.first->second;
+    }
+    for (auto &index : mesh.indices)
+    {
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation", tuned for a 32 entry LRU cache
+const uint32_t VERTEX_CACHE_SIZE = 32;
+
+static float vertexScore(int cachePosition, uint32_t liveTriangles)
+{
+    if (liveTriangles == 0)
+    {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // the last triangle's vertices get a fixed score, so no direction is preferred
+            score = 0.75f;
+        }
+        else
+        {
+            score = std::pow(1.0f - (cachePosition - 3) / static_cast<float>(VERTEX_CACHE_SIZE - 3), 1.5f);
+        }
+    }
+    // vertices with few triangles left are finished first, so they leave the working set early
+    return score + 2.0f / std::sqrt(static_cast<float>(liveTriangles));
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t amountVertices)
+{
+    size_t amountTriangles = indices.size() / 3;
+    if (amountTriangles == 0)
+    {
+        return;
+    }
+
+    // per vertex list of triangles not emitted yet, entries [offsets[v], offsets[v] + liveTriangles[v])
+    std::vector<uint32_t> liveTriangles(amountVertices, 0);
+    for (size_t i = 0; i < amountTriangles * 3; i++)
+    {
+        if (indices[i] >= amountVertices)
+        {
+            throw std::runtime_error("index out of range in vertex cache optimization!");
+        }
+        liveTriangles[indices[i]]++;
+    }
+    std::vector<uint32_t> offsets(amountVertices + 1, 0);
+    for (size_t v = 0; v < amountVertices; v++)
+    {
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(amountTriangles * 3);
+    std::vector<uint32_t> filled(amountVertices, 0);
+    for (size_t t = 0; t < amountTriangles; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[t * 3 + k];
+            adjacency[offsets[v] + filled[v]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(amountVertices, -1);
+    std::vector<float> scores(amountVertices);
+    for (size_t v = 0; v < amountVertices; v++)
+    {
+        scores[v] = vertexScore(-1, liveTriangles[v]);
+    }
+    auto triangleScore = [&](uint32_t t)
+    {
+        return scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+    };
+
+    int64_t best = 0;
+    float bestScore = triangleScore(0);
+    for (uint32_t t = 1; t < amountTriangles; t++)
+    {
+        float score = triangleScore(t);
+        if (score > bestScore)
+        {
+            best = t;
+            bestScore = score;
+        }
+    }
+
+    std::vector<bool> emitted(amountTriangles, false);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> grown;
+    std::vector<uint32_t> result;
+    result.reserve(amountTriangles * 3);
+    size_t cursor = 0;
+    while (result.size() < amountTriangles * 3)
+    {
+        if (best < 0)
+        {
+            // nothing in the cache has triangles left, continue with the next one in input order
+            while (emitted[cursor])
+            {
+                cursor++;
+            }
+            best = static_cast<int64_t>(cursor);
+        }
+        uint32_t triangle = static_cast<uint32_t>(best);
+        emitted[triangle] = true;
+
+        grown.clear();
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[triangle * 3 + k];
+            result.push_back(v);
+            // swap the triangle out of the vertex's live list
+            uint32_t *list = &adjacency[offsets[v]];
+            for (uint32_t i = 0; i < liveTriangles[v]; i++)
+            {
+                if (list[i] == triangle)
+                {
+                    list[i] = list[liveTriangles[v] - 1];
+                    break;
+                }
+            }
+            liveTriangles[v]--;
+            if (std::find(grown.begin(), grown.end(), v) == grown.end())
+            {
+                grown.push_back(v);
+            }
+        }
+        // the triangle's vertices move to the front of the LRU cache
+        size_t fresh = grown.size();
+        for (auto v : cache)
+        {
+            if (std::find(grown.begin(), grown.begin() + fresh, v) == grown.begin() + fresh)
+            {
+                grown.push_back(v);
+            }
+        }
+
+        // vertices pushed out of the cache are rescored as well, their triangles are still candidates
+        best = -1;
+        bestScore = -1.0f;
+        for (size_t i = 0; i < grown.size(); i++)
+        {
+            uint32_t v = grown[i];
+            cachePosition[v] = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+            scores[v] = vertexScore(cachePosition[v], liveTriangles[v]);
+        }
+        for (auto v : grown)
+        {
+            for (uint32_t i = 0; i < liveTriangles[v]; i++)
+            {
+                uint32_t t = adjacency[offsets[v] + i];
+                float score = triangleScore(t);
+                if (score > bestScore)
+                {
+                    best = t;
+                    bestScore = score;
+                }
+            }
+        }
+        if (grown.size() > VERTEX_CACHE_SIZE)
+        {
+            grown.resize(VERTEX_CACHE_SIZE);
+        }
+        cache.swap(grown);
+    }
+    indices.swap(result);
+}
+
+// vertices are renumbered in the order the indices first use them, unused ones are dropped
+void optimizeVertexFetch(MeshData &mesh)
+{
+    std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+    std::vector<MeshVertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for (auto &index : mesh.indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+// transformed vertices per triangle for a FIFO cache, 0.5 is the best a regular grid reaches
+float averageCacheMissRatio(const std::vector<uint32_t> &indices, size_t amountVertices, uint32_t cacheSize)
+{
+    if (indices.size() < 3)
+    {
+        return 0.0f;
+    }
+    std::vector<uint32_t> timestamps(amountVertices, 0);
+    uint32_t time = cacheSize + 1;
+    uint32_t misses = 0;
+    for (auto index : indices)
+    {
+        if (time - timestamps[index] > cacheSize)
+        {
+            timestamps[index] = time++;
+            misses++;
+        }
+    }
+    return misses / static_cast<float>(indices.size() / 3);
+}
+
+// sum of squared distances to a set of planes, stored as the upper triangle of the symmetric 4x4 matrix
+struct Quadric
+{
+    double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double b2 = 0.0, bc = 0.0, bd = 0.0;
+    double c2 = 0.0, cd = 0.0;
+    double d2 = 0.0;
+
+    void addPlane(glm::vec3 normal, float distance, float weight)
+    {
+        double a = normal.x, b = normal.y, c = normal.z, d = distance;
+        a2 += weight * a * a;
+        ab += weight * a * b;
+        ac += weight * a * c;
+        ad += weight * a * d;
+        b2 += weight * b * b;
+        bc += weight * b * c;
+        bd += weight * b * d;
+        c2 += weight * c * c;
+        cd += weight * c * d;
+        d2 += weight * d * d;
+    }
+
+    void add(const Quadric &other)
+    {
+        a2 += other.a2;
+        ab += other.ab;
+        ac += other.ac;
+        ad += other.ad;
+        b2 += other.b2;
+        bc += other.bc;
+        bd += other.bd;
+        c2 += other.c2;
+        cd += other.cd;
+        d2 += other.d2;
+    }
+
+    double error(glm::vec3 p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double result = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x +
+                        b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y +
+                        c2 * z * z + 2.0 * cd * z + d2;
+        return std::max(result, 0.0);
+    }
+};
+
+struct PositionHash
+{
+    size_t operator()(const glm::vec3 &position) const
+    {
+        uint32_t words[3];
+        memcpy(words, &position, sizeof(words));
+        size_t seed = 0;
+        for (auto word : words)
+        {
+            hashCombine(seed, word);
+        }
+        return seed;
+    }
+};
+
+struct PositionEqual
+{
+    bool operator()(const glm::vec3 &a, const glm::vec3 &b) const
+    {
+        return memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+// boundary edges are kept in place by a plane through them, perpendicular to their triangle
+const float BOUNDARY_WEIGHT = 10.0f;
+
+// quadric error metric edge collapse (Garland and Heckbert), vertices only ever move onto one of their
+// neighbours so all levels share the vertex buffer; error is the largest collapse error, roughly a distance
+std::vector<uint32_t> simplifyMesh(const std::vector<MeshVertex> &vertices, std::vector<uint32_t> indices, size_t targetIndexCount, float &error)
+{
+    size_t amountVertices = vertices.size();
+    error = 0.0f;
+
+    // vertices sharing their position with another one in use lie on an attribute seam, moving them would tear it open
+    std::vector<bool> used(amountVertices, false);
+    for (auto index : indices)
+    {
+        used[index] = true;
+    }
+    std::vector<bool> seam(amountVertices, false);
+    std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> firstAtPosition;
+    for (uint32_t v = 0; v < amountVertices; v++)
+    {
+        if (!used[v])
+        {
+            continue;
+        }
+        auto inserted = firstAtPosition.emplace(vertices[v].pos, v);
+        if (!inserted.second)
+        {
+            seam[v] = true;
+            seam[inserted.first->second] = true;
+        }
+    }
+
+    auto edgeKey = [](uint32_t a, uint32_t b)
+    {
+        return static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+    };
+    std::vector<Quadric> quadrics(amountVertices);
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            edgeUses[edgeKey(indices[i + k], indices[i + (k + 1) % 3])]++;
+        }
+    }
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        glm::vec3 corners[3] = {vertices[indices[i]].pos, vertices[indices[i + 1]].pos, vertices[indices[i + 2]].pos};
+        auto normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+        float length = glm::length(normal);
+        if (length == 0.0f)
+        {
+            continue;
+        }
+        normal = normal / length;
+        for (int k = 0; k < 3; k++)
+        {
+            quadrics[indices[i + k]].addPlane(normal, -glm::dot(normal, corners[0]), 1.0f);
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+            if (edgeUses[edgeKey(a, b)] != 1)
+            {
+                continue;
+            }
+            auto edge = corners[(k + 1) % 3] - corners[k];
+            float edgeLength = glm::length(edge);
+            if (edgeLength == 0.0f)
+            {
+                continue;
+            }
+            auto boundaryNormal = glm::cross(edge / edgeLength, normal);
+            float distance = -glm::dot(boundaryNormal, corners[k]);
+            quadrics[a].addPlane(boundaryNormal, distance, BOUNDARY_WEIGHT);
+            quadrics[b].addPlane(boundaryNormal, distance, BOUNDARY_WEIGHT);
+        }
+    }
+
+    std::vector<Collapse> collapses;
+    std::vector<bool> locked(amountVertices);
+    std::vector<uint32_t> offsets(amountVertices + 1);
+    std::vector<uint32_t> adjacency;
+    double maxCost = 0.0;
+    while (indices.size() > targetIndexCount)
+    {
+        collapses.clear();
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t a = indices[i + k];
+                uint32_t b = indices[i + (k + 1) % 3];
+                Quadric combined = quadrics[a];
+                combined.add(quadrics[b]);
+                if (!seam[a])
+                {
+                    collapses.push_back(Collapse{a, b, combined.error(vertices[b].pos)});
+                }
+                if (!seam[b])
+                {
+                    collapses.push_back(Collapse{b, a, combined.error(vertices[a].pos)});
+                }
+            }
+        }
+        if (collapses.empty())
+        {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b)
+                  { return a.cost < b.cost; });
+
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (auto index : indices)
+        {
+            offsets[index + 1]++;
+        }
+        for (size_t v = 0; v < amountVertices; v++)
+        {
+            offsets[v + 1] += offsets[v];
+        }
+        adjacency.resize(indices.size());
+        std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // collapses within one pass must not touch each other's triangles, the rest waits for the next pass
+        std::fill(locked.begin(), locked.end(), false);
+        size_t removableTriangles = (indices.size() - targetIndexCount) / 3;
+        size_t removedTriangles = 0;
+        // once cheaper collapses had to be skipped for locks, the pass ends before it gets much more expensive
+        double blockedCost = std::numeric_limits<double>::max();
+        for (auto &collapse : collapses)
+        {
+            if (removedTriangles >= removableTriangles || collapse.cost > blockedCost * 2.0)
+            {
+                break;
+            }
+            if (locked[collapse.from] || locked[collapse.to])
+            {
+                blockedCost = std::min(blockedCost, collapse.cost);
+                continue;
+            }
+
+            // moving a vertex must not fold any of its remaining triangles over
+            bool flips = false;
+            size_t shared = 0;
+            for (uint32_t j = offsets[collapse.from]; j < offsets[collapse.from + 1] && !flips; j++)
+            {
+                uint32_t *triangle = &indices[adjacency[j] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    shared++;
+                    continue;
+                }
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    before[k] = vertices[triangle[k]].pos;
+                    after[k] = triangle[k] == collapse.from ? vertices[collapse.to].pos : before[k];
+                }
+                auto normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                auto normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+            }
+            if (flips || shared == 0)
+            {
+                continue;
+            }
+
+            for (uint32_t j = offsets[collapse.from]; j < offsets[collapse.from + 1]; j++)
+            {
+                uint32_t *triangle = &indices[adjacency[j] * 3];
+                for (int k = 0; k < 3; k++)
+                {
+                    locked[triangle[k]] = true;
+                    if (triangle[k] == collapse.from)
+                    {
+                        triangle[k] = collapse.to;
+                    }
+                }
+            }
+            for (uint32_t j = offsets[collapse.to]; j < offsets[collapse.to + 1]; j++)
+            {
+                uint32_t *triangle = &indices[adjacency[j] * 3];
+                for (int k = 0; k < 3; k++)
+                {
+                    locked[triangle[k]] = true;
+                }
+            }
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxCost = std::max(maxCost, collapse.cost);
+            removedTriangles += shared;
+        }
+        if (removedTriangles == 0)
+        {
+            break;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            if (a != b && b != c && a != c)
+            {
+                indices[kept++] = a;
+                indices[kept++] = b;
+                indices[kept++] = c;
+            }
+        }
+        indices.resize(kept);
+    }
+    error = static_cast<float>(std::sqrt(maxCost));
+    return indices;
+}
+
+// level 0 is the mesh itself, every further level aims for half the triangles of the one before,
+// levels stop early once simplification gets stuck on seams or boundaries; errors[l] is level l's simplifyMesh error.
+// with face normals every vertex shares its position with the corners of the neighbouring faces and would be a seam,
+// so those meshes are simplified welded by position, then each corner takes the vertex at its position whose normal
+// fits its triangle best
+std::vector<std::vector<uint32_t>> generateLods(const MeshData &mesh, uint32_t amountLods, std::vector<float> &errors)
+{
+    std::vector<std::vector<uint32_t>> lods{mesh.indices};
+    errors.assign(1, 0.0f);
+    std::unordered_map<glm::vec3, std::vector<uint32_t>, PositionHash, PositionEqual> atPosition;
+    auto previous = mesh.indices;
+    if (mesh.faceNormals)
+    {
+        for (uint32_t v = 0; v < mesh.vertices.size(); v++)
+        {
+            atPosition[mesh.vertices[v].pos].push_back(v);
+        }
+        for (auto &index : previous)
+        {
+            index = atPosition[mesh.vertices[index].pos].front();
+        }
+    }
+    for (uint32_t i = 0; i < amountLods; i++)
+    {
+        float error;
+        auto lod = simplifyMesh(mesh.vertices, previous, previous.size() / 6 * 3, error);
+        if (lod.empty() || lod.size() > previous.size() * 9 / 10)
+        {
+            break;
+        }
+        previous = lod;
+        if (mesh.faceNormals)
+        {
+            for (size_t t = 0; t + 2 < lod.size(); t += 3)
+            {
+                auto normal = faceNormal(mesh.vertices[lod[t]].pos, mesh.vertices[lod[t + 1]].pos, mesh.vertices[lod[t + 2]].pos);
+                for (size_t k = t; k < t + 3; k++)
+                {
+                    float bestFit = -2.0f;
+                    for (auto candidate : atPosition[mesh.vertices[lod[k]].pos])
+                    {
+                        float fit = glm::dot(mesh.vertices[candidate].normal, normal);
+                        if (fit > bestFit)
+                        {
+                            bestFit = fit;
+                            lod[k] = candidate;
+                        }
+                    }
+                }
+            }
+        }
+        optimizeVertexCache(lod, mesh.vertices.size());
+        lods.push_back(std::move(lod));
+        errors.push_back(error);
+    }
+    return lods;
+}
+
+void boundingSphere(const std::vector<MeshVertex> &vertices, glm::vec3 &center, float &radius)
+{
+    center = glm::vec3(0.0f);
+    radius = 0.0f;
+    if (vertices.empty())
+    {
+        return;
+    }
+    glm::vec3 low = vertices[0].pos;
+    glm::vec3 high = vertices[0].pos;
+    for (auto &vertex : vertices)
+    {
+        low = glm::min(low, vertex.pos);
+        high = glm::max(high, vertex.pos);
+    }
+    center = (low + high) * 0.5f;
+    for (auto &vertex : vertices)
+    {
+        radius = std::max(radius, glm::length(vertex.pos - center));
+    }
+}
+
+// diameter in pixels of a bounding sphere, a sphere around the camera covers the whole screen
+float projectedDiameter(glm::vec3 center, float radius, const glm::mat4 &modelView, const glm::mat4 &projection, float viewportHeight)
+{
+    auto viewCenter = modelView * glm::vec4(center, 1.0f);
+    float scale = std::max(glm::length(glm::vec3(modelView[0].x, modelView[0].y, modelView[0].z)),
+                           std::max(glm::length(glm::vec3(modelView[1].x, modelView[1].y, modelView[1].z)),
+                                    glm::length(glm::vec3(modelView[2].x, modelView[2].y, modelView[2].z))));
+    float viewRadius = radius * scale;
+    // projection[2][3] is 0 for orthographic projections
+    if (projection[2][3] == 0.0f)
+    {
+        return viewRadius * std::abs(projection[1][1]) * viewportHeight;
+    }
+    float distance = -viewCenter.z;
+    if (distance <= viewRadius)
+    {
+        return std::numeric_limits<float>::max();
+    }
+    return viewRadius * std::abs(projection[1][1]) / distance * viewportHeight;
+}
+
+static bool endsWith(const std::string &string, const std::string &suffix)
+{
+    return string.size() >= suffix.size() && string.compare(string.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// .obj or .glb, ready to upload: deduplicated, in vertex cache order and with vertices in fetch order
+MeshData loadMesh(std::string path)
+{
+    MeshData mesh;
+    if (endsWith(path, ".obj"))
+    {
+        mesh = loadObj(path);
+    }
+    else if (endsWith(path, ".glb"))
+    {
+        mesh = loadGlb(path);
+    }
+    else
+    {
+        throw std::runtime_error("unsupported mesh format: " + path);
+    }
+    deduplicateVertices(mesh);
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeVertexFetch(mesh);
+    return mesh;
+}
\ No newline at end of file
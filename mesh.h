@@ -0,0 +1,27 @@
+#ifndef mesh_h
+#define mesh_h
+
+#include "common.cpp"
+#include "vertex.h"
+
+struct MeshData
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    // set by loadObj when faces without normals got their face normal, see generateLods
+    bool faceNormals = false;
+};
+
+MeshData loadObj(std::string path);
+MeshData loadGlb(std::string path);
+MeshData loadMesh(std::string path);
+void deduplicateVertices(MeshData &mesh);
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t amountVertices);
+void optimizeVertexFetch(MeshData &mesh);
+float averageCacheMissRatio(const std::vector<uint32_t> &indices, size_t amountVertices, uint32_t cacheSize = 32);
+std::vector<uint32_t> simplifyMesh(const std::vector<MeshVertex> &vertices, std::vector<uint32_t> indices, size_t targetIndexCount, float &error);
+std::vector<std::vector<uint32_t>> generateLods(const MeshData &mesh, uint32_t amountLods, std::vector<float> &errors);
+void boundingSphere(const std::vector<MeshVertex> &vertices, glm::vec3 &center, float &radius);
+float projectedDiameter(glm::vec3 center, float radius, const glm::mat4 &modelView, const glm::mat4 &projection, float viewportHeight);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#include "common.cpp"
+#include "graphicsPipeline.h"
+#include "pipelineCompiler.h"
+
+void PipelineCompiler::start(JobSystem *jobs, VkDevice logicalDevice, VkPipelineCache pipelineCache, ShaderRegistry *shaders, LayoutCache *layouts)
+{
+    this->jobs = jobs;
+    this->logicalDevice = logicalDevice;
+    this->pipelineCache = pipelineCache;
+    this->shaders = shaders;
+    this->layouts = layouts;
+}
+
+GraphicsPipeline PipelineCompiler::compile(const PipelineDescription &description)
+{
+    return createGraphicsPipeline(description, logicalDevice, pipelineCache, *shaders, *layouts);
+}
+
+// without workers nothing would run the job until the main thread waits, so it compiles right away
+std::shared_future<GraphicsPipeline> PipelineCompiler::submit(PipelineDescription description)
+{
+    auto result = std::make_shared<std::promise<GraphicsPipeline>>();
+    std::shared_future<GraphicsPipeline> future = result->get_future().share();
+    auto job = [this, description, result]
+    {
+        try
+        {
+            result->set_value(compile(description));
+        }
+        catch (...)
+        {
+            result->set_exception(std::current_exception());
+        }
+    };
+    if (jobs->amountThreads() <= 1)
+    {
+        job();
+    }
+    else
+    {
+        jobs->run(job, &compiling);
+    }
+    return future;
+}
+
+// finishes all submitted compilations
+void PipelineCompiler::stop()
+{
+    jobs->wait(compiling);
+}
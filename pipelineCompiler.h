@@ -0,0 +1,29 @@
+#ifndef pipeline_compiler_h
+#define pipeline_compiler_h
+
+#include "common.cpp"
+#include "shaderRegistry.h"
+#include "layoutCache.h"
+#include "jobSystem.h"
+
+// compiles graphics pipelines as job system jobs against one shared VkPipelineCache
+class PipelineCompiler
+{
+public:
+    VkDevice logicalDevice;
+    VkPipelineCache pipelineCache;
+    ShaderRegistry *shaders;
+    LayoutCache *layouts;
+
+    void start(JobSystem *jobs, VkDevice logicalDevice, VkPipelineCache pipelineCache, ShaderRegistry *shaders, LayoutCache *layouts);
+    std::shared_future<GraphicsPipeline> submit(PipelineDescription description);
+    void stop();
+
+private:
+    JobSystem *jobs;
+    JobCounter compiling;
+
+    GraphicsPipeline compile(const PipelineDescription &description);
+};
+
+#endif
@@ -0,0 +1,565 @@
+#include "common.cpp"
+#include "renderGraph.h"
+#include "image.h"
+#include "vkMemory.h"
+#include "computePipeline.h"
+
+void RenderGraph::init(VkDevice logicalDevice, VkPhysicalDevice physicalDevice)
+{
+    this->logicalDevice = logicalDevice;
+    this->physicalDevice = physicalDevice;
+    // slot 0 is the swapchain image, its views and extent come from the swapchain
+    Attachment swapchainAttachment;
+    swapchainAttachment.name = "swapchain";
+    swapchainAttachment.format = VK_FORMAT_UNDEFINED;
+    swapchainAttachment.depth = false;
+    swapchainAttachment.scale = 1.0f;
+    attachments.push_back(swapchainAttachment);
+}
+
+uint32_t RenderGraph::createAttachment(std::string name, VkFormat format, bool depth, float scale)
+{
+    Attachment attachment;
+    attachment.name = name;
+    attachment.format = format;
+    attachment.depth = depth;
+    attachment.scale = scale;
+    attachments.push_back(attachment);
+    compiled = false;
+    return attachments.size() - 1;
+}
+
+// passes run in the order they are added
+void RenderGraph::addPass(std::string name, std::vector<uint32_t> reads, std::vector<uint32_t> colorWrites, uint32_t depthWrite, RecordPass record)
+{
+    Pass pass;
+    pass.name = name;
+    pass.reads = reads;
+    pass.colorWrites = colorWrites;
+    pass.depthWrite = depthWrite;
+    pass.record = record;
+    passes.push_back(pass);
+    compiled = false;
+}
+
+std::vector<uint32_t> RenderGraph::Pass::writes() const
+{
+    auto writes = colorWrites;
+    if (depthWrite != NO_ATTACHMENT)
+    {
+        writes.push_back(depthWrite);
+    }
+    return writes;
+}
+
+bool RenderGraph::empty()
+{
+    return passes.empty();
+}
+
+bool RenderGraph::isCompiled()
+{
+    return compiled;
+}
+
+bool RenderGraph::isAlive(std::string pass)
+{
+    for (auto &p : passes)
+    {
+        if (p.name == pass)
+        {
+            return p.alive;
+        }
+    }
+    return false;
+}
+
+VkRenderPass RenderGraph::getRenderPass(std::string pass)
+{
+    for (auto &p : passes)
+    {
+        if (p.name == pass)
+        {
+            return p.renderPass;
+        }
+    }
+    throw std::runtime_error("render graph has no pass " + pass);
+}
+
+// views change on resize, descriptor sets sampling them should be written per frame
+VkImageView RenderGraph::getView(uint32_t attachment)
+{
+    return attachments[attachment].view;
+}
+
+void RenderGraph::compile(SwapChain &swapchain)
+{
+    destroyAttachments();
+    for (auto &pass : passes)
+    {
+        if (pass.renderPass != VK_NULL_HANDLE)
+        {
+            vkDestroyRenderPass(logicalDevice, pass.renderPass, nullptr);
+            pass.renderPass = VK_NULL_HANDLE;
+        }
+    }
+
+    // a pass that continues an attachment another pass started depends on that pass
+    std::vector<int> firstWriter(attachments.size(), -1);
+    for (int i = 0; i < passes.size(); i++)
+    {
+        for (auto write : passes[i].writes())
+        {
+            if (firstWriter[write] == -1)
+            {
+                firstWriter[write] = i;
+            }
+        }
+    }
+
+    // walk backwards from the swapchain, passes writing nothing that is needed later are culled
+    std::vector<bool> needed(attachments.size(), false);
+    needed[SWAPCHAIN_ATTACHMENT] = true;
+    for (int i = passes.size() - 1; i >= 0; i--)
+    {
+        auto &pass = passes[i];
+        pass.alive = false;
+        for (auto write : pass.writes())
+        {
+            pass.alive = pass.alive || needed[write];
+        }
+        if (!pass.alive)
+        {
+            continue;
+        }
+        for (auto read : pass.reads)
+        {
+            needed[read] = true;
+        }
+        for (auto write : pass.writes())
+        {
+            needed[write] = needed[write] || firstWriter[write] != i;
+        }
+    }
+
+    for (auto &attachment : attachments)
+    {
+        attachment.firstUse = -1;
+        attachment.lastUse = -1;
+        attachment.usage = attachment.depth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    }
+    for (int i = 0; i < passes.size(); i++)
+    {
+        if (!passes[i].alive)
+        {
+            continue;
+        }
+        for (auto read : passes[i].reads)
+        {
+            if (read == SWAPCHAIN_ATTACHMENT)
+            {
+                throw std::runtime_error("render graph cannot sample the swapchain image!");
+            }
+            attachments[read].usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+        }
+        auto uses = passes[i].writes();
+        uses.insert(uses.end(), passes[i].reads.begin(), passes[i].reads.end());
+        for (auto use : uses)
+        {
+            if (attachments[use].firstUse == -1)
+            {
+                attachments[use].firstUse = i;
+            }
+            attachments[use].lastUse = i;
+        }
+    }
+    if (attachments[SWAPCHAIN_ATTACHMENT].firstUse == -1)
+    {
+        throw std::runtime_error("render graph never writes the swapchain image!");
+    }
+    for (auto &attachment : attachments)
+    {
+        // only used by a single pass and never sampled, so nothing is loaded from or stored to memory and the
+        // contents only live inside that render pass
+        if (attachment.firstUse != -1 && attachment.firstUse == attachment.lastUse && !(attachment.usage & VK_IMAGE_USAGE_SAMPLED_BIT))
+        {
+            attachment.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
+    }
+
+    createRenderPasses(swapchain);
+    createAttachments(swapchain);
+    compiled = true;
+}
+
+void RenderGraph::createRenderPasses(SwapChain &swapchain)
+{
+    std::vector<VkImageLayout> layouts(attachments.size(), VK_IMAGE_LAYOUT_UNDEFINED);
+    std::vector<bool> written(attachments.size(), false);
+    for (int i = 0; i < passes.size(); i++)
+    {
+        auto &pass = passes[i];
+        if (!pass.alive)
+        {
+            continue;
+        }
+        for (auto read : pass.reads)
+        {
+            if (!written[read])
+            {
+                throw std::runtime_error("render graph pass " + pass.name + " reads " + attachments[read].name + " before it is written!");
+            }
+        }
+
+        auto writes = pass.writes();
+        std::vector<VkAttachmentDescription> descriptions(writes.size());
+        std::vector<VkAttachmentReference> colorReferences;
+        VkAttachmentReference depthReference{};
+        pass.clearValues.resize(writes.size());
+        for (uint32_t w = 0; w < writes.size(); w++)
+        {
+            auto index = writes[w];
+            auto &attachment = attachments[index];
+            VkImageLayout attachmentLayout = attachment.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+            // the layout the attachment has to be in for its next use decides the final layout, storing is only needed if there is one
+            int nextUse = -1;
+            bool nextUseReads = false;
+            for (int j = i + 1; j < passes.size() && nextUse == -1; j++)
+            {
+                if (!passes[j].alive)
+                {
+                    continue;
+                }
+                auto &reads = passes[j].reads;
+                auto laterWrites = passes[j].writes();
+                if (std::find(reads.begin(), reads.end(), index) != reads.end())
+                {
+                    nextUse = j;
+                    nextUseReads = true;
+                }
+                else if (std::find(laterWrites.begin(), laterWrites.end(), index) != laterWrites.end())
+                {
+                    nextUse = j;
+                }
+            }
+
+            auto &description = descriptions[w];
+            description.format = index == SWAPCHAIN_ATTACHMENT ? swapchain.imageFormat : attachment.format;
+            description.samples = VK_SAMPLE_COUNT_1_BIT;
+            description.loadOp = written[index] ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+            description.storeOp = nextUse != -1 || index == SWAPCHAIN_ATTACHMENT ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            description.initialLayout = written[index] ? layouts[index] : VK_IMAGE_LAYOUT_UNDEFINED;
+            if (nextUseReads)
+            {
+                description.finalLayout = attachment.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            }
+            else if (nextUse == -1 && index == SWAPCHAIN_ATTACHMENT)
+            {
+                description.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            }
+            else
+            {
+                description.finalLayout = attachmentLayout;
+            }
+            layouts[index] = description.finalLayout;
+            written[index] = true;
+
+            if (attachment.depth)
+            {
+                depthReference = VkAttachmentReference{w, attachmentLayout};
+                pass.clearValues[w].depthStencil = {1.0f, 0};
+            }
+            else
+            {
+                colorReferences.push_back(VkAttachmentReference{w, attachmentLayout});
+                pass.clearValues[w].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+            }
+        }
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+        subpass.pColorAttachments = colorReferences.data();
+        subpass.pDepthStencilAttachment = pass.depthWrite != NO_ATTACHMENT ? &depthReference : nullptr;
+
+        // attachment writes of earlier passes become visible to sampling and loading in this one, and aliased
+        // memory is only reused once the previous owner's last pass is done with it
+        VkPipelineStageFlags attachmentStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        VkAccessFlags attachmentWrites = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        VkSubpassDependency dependencies[2]{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = attachmentStages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[0].srcAccessMask = attachmentWrites;
+        dependencies[0].dstStageMask = attachmentStages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[0].dstAccessMask = attachmentWrites | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = attachmentStages;
+        dependencies[1].srcAccessMask = attachmentWrites;
+        dependencies[1].dstStageMask = attachmentStages | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[1].dstAccessMask = attachmentWrites | VK_ACCESS_SHADER_READ_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+        renderPassInfo.pAttachments = descriptions.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 2;
+        renderPassInfo.pDependencies = dependencies;
+
+        if (vkCreateRenderPass(logicalDevice, &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create render pass!");
+        }
+    }
+}
+
+// everything that depends on the swapchain extent: images, their memory, views and framebuffers
+void RenderGraph::createAttachments(SwapChain &swapchain)
+{
+    struct MemoryBlock
+    {
+        VkDeviceSize size;
+        uint32_t memoryTypeBits;
+        std::vector<uint32_t> users;
+    };
+    std::vector<MemoryBlock> blocks;
+    std::vector<VkMemoryRequirements> requirements(attachments.size());
+    std::vector<uint32_t> blockOf(attachments.size());
+    std::vector<uint32_t> order;
+
+    for (uint32_t i = 1; i < attachments.size(); i++)
+    {
+        auto &attachment = attachments[i];
+        if (attachment.firstUse == -1)
+        {
+            continue;
+        }
+        attachment.extent.width = std::max(1u, static_cast<uint32_t>(swapchain.extent.width * attachment.scale));
+        attachment.extent.height = std::max(1u, static_cast<uint32_t>(swapchain.extent.height * attachment.scale));
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = attachment.extent.width;
+        imageInfo.extent.height = attachment.extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = attachment.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = attachment.usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &attachment.image) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create image!");
+        }
+        vkGetImageMemoryRequirements(logicalDevice, attachment.image, &requirements[i]);
+        order.push_back(i);
+    }
+
+    // largest first, every attachment goes into the first block whose users are all dead before it starts or born after it ends
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+              { return requirements[a].size > requirements[b].size; });
+    for (auto i : order)
+    {
+        auto &attachment = attachments[i];
+        bool placed = false;
+        for (uint32_t b = 0; b < blocks.size() && !placed; b++)
+        {
+            auto &block = blocks[b];
+            if (!(block.memoryTypeBits & requirements[i].memoryTypeBits))
+            {
+                continue;
+            }
+            bool overlaps = false;
+            for (auto user : block.users)
+            {
+                overlaps = overlaps || (attachment.firstUse <= attachments[user].lastUse && attachments[user].firstUse <= attachment.lastUse);
+            }
+            if (overlaps)
+            {
+                continue;
+            }
+            block.size = std::max(block.size, requirements[i].size);
+            block.memoryTypeBits &= requirements[i].memoryTypeBits;
+            block.users.push_back(i);
+            blockOf[i] = b;
+            placed = true;
+        }
+        if (!placed)
+        {
+            blocks.push_back(MemoryBlock{requirements[i].size, requirements[i].memoryTypeBits, std::vector<uint32_t>{i}});
+            blockOf[i] = blocks.size() - 1;
+        }
+    }
+
+    memory.resize(blocks.size());
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = blocks[b].size;
+        allocInfo.memoryTypeIndex = findMemoryType(blocks[b].memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, physicalDevice);
+        if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &memory[b]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate image memory!");
+        }
+    }
+    for (auto i : order)
+    {
+        auto &attachment = attachments[i];
+        vkBindImageMemory(logicalDevice, attachment.image, memory[blockOf[i]], 0);
+        attachment.view = createImageView(attachment.image, attachment.format, attachment.depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT, logicalDevice);
+    }
+
+    for (auto &pass : passes)
+    {
+        if (!pass.alive)
+        {
+            continue;
+        }
+        auto writes = pass.writes();
+        bool writesSwapchain = std::find(writes.begin(), writes.end(), SWAPCHAIN_ATTACHMENT) != writes.end();
+        pass.extent = writes[0] == SWAPCHAIN_ATTACHMENT ? swapchain.extent : attachments[writes[0]].extent;
+        pass.framebuffers.resize(writesSwapchain ? swapchain.imageViews.size() : 1);
+        for (size_t f = 0; f < pass.framebuffers.size(); f++)
+        {
+            std::vector<VkImageView> views;
+            for (auto write : writes)
+            {
+                views.push_back(write == SWAPCHAIN_ATTACHMENT ? swapchain.imageViews[f] : attachments[write].view);
+            }
+            VkFramebufferCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            info.renderPass = pass.renderPass;
+            info.attachmentCount = static_cast<uint32_t>(views.size());
+            info.pAttachments = views.data();
+            info.width = pass.extent.width;
+            info.height = pass.extent.height;
+            info.layers = 1;
+            if (vkCreateFramebuffer(logicalDevice, &info, nullptr, &pass.framebuffers[f]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create framebuffer!");
+            }
+        }
+    }
+}
+
+void RenderGraph::destroyAttachments()
+{
+    for (auto &pass : passes)
+    {
+        for (auto framebuffer : pass.framebuffers)
+        {
+            vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+        }
+        pass.framebuffers.clear();
+    }
+    for (size_t i = 1; i < attachments.size(); i++)
+    {
+        if (attachments[i].image != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(logicalDevice, attachments[i].view, nullptr);
+            vkDestroyImage(logicalDevice, attachments[i].image, nullptr);
+            attachments[i].view = VK_NULL_HANDLE;
+            attachments[i].image = VK_NULL_HANDLE;
+        }
+    }
+    for (auto block : memory)
+    {
+        vkFreeMemory(logicalDevice, block, nullptr);
+    }
+    memory.clear();
+}
+
+// render passes only depend on formats and survive, pipelines built against them stay valid
+void RenderGraph::resize(SwapChain &swapchain)
+{
+    // compile() creates the attachments for the new extent anyway
+    if (!compiled)
+    {
+        return;
+    }
+    destroyAttachments();
+    createAttachments(swapchain);
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::vector<DrawCommand> &draws, VkDescriptorSet textureSet)
+{
+    if (!compiled)
+    {
+        throw std::runtime_error("render graph has to be compiled before it is executed!");
+    }
+    for (auto &pass : passes)
+    {
+        if (!pass.alive)
+        {
+            continue;
+        }
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = pass.renderPass;
+        renderPassInfo.framebuffer = pass.framebuffers.size() > 1 ? pass.framebuffers[imageIndex] : pass.framebuffers[0];
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = pass.extent;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+        renderPassInfo.pClearValues = pass.clearValues.data();
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        pass.record(commandBuffer, pass.extent, draws, textureSet);
+        vkCmdEndRenderPass(commandBuffer);
+    }
+}
+
+void RenderGraph::destroy()
+{
+    destroyAttachments();
+    for (auto &pass : passes)
+    {
+        if (pass.renderPass != VK_NULL_HANDLE)
+        {
+            vkDestroyRenderPass(logicalDevice, pass.renderPass, nullptr);
+        }
+    }
+    passes.clear();
+    attachments.resize(1);
+    compiled = false;
+}
+
+void recordRenderGraph(VkCommandBuffer commandBuffer, uint32_t imageIndex, RenderGraph &graph, const std::vector<DrawCommand> &draws, const std::vector<ComputeDispatch> &dispatches, VkDescriptorSet textureSet, VkQueryPool statisticsQueries, uint32_t query)
+{
+    // checked before recording starts, so a failure leaves the command buffer untouched
+    if (!graph.isCompiled())
+    {
+        throw std::runtime_error("render graph has to be compiled before it is recorded!");
+    }
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+    recordDispatches(commandBuffer, dispatches, true);
+    if (statisticsQueries != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(commandBuffer, statisticsQueries, query, 1);
+        vkCmdBeginQuery(commandBuffer, statisticsQueries, query, 0);
+    }
+    graph.execute(commandBuffer, imageIndex, draws, textureSet);
+    if (statisticsQueries != VK_NULL_HANDLE)
+    {
+        vkCmdEndQuery(commandBuffer, statisticsQueries, query);
+    }
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
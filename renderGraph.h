@@ -0,0 +1,73 @@
+#ifndef render_graph_h
+#define render_graph_h
+
+#include "common.cpp"
+
+// passes declare the attachments they read and write, compile() culls passes whose results are never used,
+// picks load/store ops and layouts, and lets transient attachments with disjoint lifetimes share memory
+class RenderGraph
+{
+public:
+    void init(VkDevice logicalDevice, VkPhysicalDevice physicalDevice);
+    uint32_t createAttachment(std::string name, VkFormat format, bool depth, float scale = 1.0f);
+    void addPass(std::string name, std::vector<uint32_t> reads, std::vector<uint32_t> colorWrites, uint32_t depthWrite, RecordPass record);
+    void compile(SwapChain &swapchain);
+    void resize(SwapChain &swapchain);
+    void execute(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::vector<DrawCommand> &draws, VkDescriptorSet textureSet);
+    bool empty();
+    bool isCompiled();
+    bool isAlive(std::string pass);
+    VkRenderPass getRenderPass(std::string pass);
+    VkImageView getView(uint32_t attachment);
+    void destroy();
+
+private:
+    struct Attachment
+    {
+        std::string name;
+        VkFormat format;
+        bool depth;
+        // relative to the swapchain extent
+        float scale;
+        VkImageUsageFlags usage = 0;
+        VkExtent2D extent;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        // alive pass indices of the first and last use, -1 if unused
+        int firstUse = -1;
+        int lastUse = -1;
+    };
+    struct Pass
+    {
+        std::string name;
+        std::vector<uint32_t> reads;
+        std::vector<uint32_t> colorWrites;
+        uint32_t depthWrite;
+        RecordPass record;
+        bool alive = false;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        // one per swapchain image when writing the swapchain
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<VkClearValue> clearValues;
+        VkExtent2D extent;
+
+        std::vector<uint32_t> writes() const;
+    };
+
+    void createRenderPasses(SwapChain &swapchain);
+    void createAttachments(SwapChain &swapchain);
+    void destroyAttachments();
+
+    VkDevice logicalDevice;
+    VkPhysicalDevice physicalDevice;
+    std::vector<Attachment> attachments;
+    std::vector<Pass> passes;
+    // cleared by every change to the graph, render passes and attachments only match it after compile()
+    bool compiled = false;
+    // memory shared by aliased attachments
+    std::vector<VkDeviceMemory> memory;
+};
+
+void recordRenderGraph(VkCommandBuffer commandBuffer, uint32_t imageIndex, RenderGraph &graph, const std::vector<DrawCommand> &draws, const std::vector<ComputeDispatch> &dispatches, VkDescriptorSet textureSet, VkQueryPool statisticsQueries, uint32_t query);
+
+#endif
@@ -0,0 +1,166 @@
+#include "common.cpp"
+#include "resourceCache.h"
+#include "image.h"
+
+// every field that affects the sampler, pNext chains are not supported
+static bool sameSamplerInfo(const VkSamplerCreateInfo &a, const VkSamplerCreateInfo &b)
+{
+    return a.flags == b.flags &&
+           a.magFilter == b.magFilter &&
+           a.minFilter == b.minFilter &&
+           a.mipmapMode == b.mipmapMode &&
+           a.addressModeU == b.addressModeU &&
+           a.addressModeV == b.addressModeV &&
+           a.addressModeW == b.addressModeW &&
+           a.mipLodBias == b.mipLodBias &&
+           a.anisotropyEnable == b.anisotropyEnable &&
+           a.maxAnisotropy == b.maxAnisotropy &&
+           a.compareEnable == b.compareEnable &&
+           a.compareOp == b.compareOp &&
+           a.minLod == b.minLod &&
+           a.maxLod == b.maxLod &&
+           a.borderColor == b.borderColor &&
+           a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+void ResourceCache::init(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, CommandPools *commandPools, VkQueues queues, BindlessTextures *bindless)
+{
+    this->logicalDevice = logicalDevice;
+    this->physicalDevice = physicalDevice;
+    this->commandPools = commandPools;
+    this->queues = queues;
+    this->bindless = bindless;
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+}
+
+// textures/<name>.png, loaded on the first acquire
+// loads without holding the lock so threads decode different textures at the same time, when two threads load the
+// same one the later of them drops its copy
+Texture ResourceCache::acquireTexture(std::string name)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto cached = textures.find(name);
+        if (cached != textures.end())
+        {
+            textureHits++;
+            cached->second.refCount++;
+            return cached->second.texture;
+        }
+        textureMisses++;
+    }
+    Texture texture = createTextureImage(logicalDevice, physicalDevice, commandPools->current(), queues, name);
+    texture.imageView = createTextureImageView(texture, logicalDevice);
+    if (bindless != nullptr)
+    {
+        texture.bindlessIndex = bindless->add(texture.imageView);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto cached = textures.find(name);
+    if (cached != textures.end())
+    {
+        destroyTexture(texture);
+        cached->second.refCount++;
+        return cached->second.texture;
+    }
+    textures[name] = TextureEntry{texture, 1};
+    return texture;
+}
+
+// false if the texture didn't come from the cache
+bool ResourceCache::releaseTexture(Texture texture)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = textures.begin(); it != textures.end(); it++)
+    {
+        if (it->second.texture.textureImage != texture.textureImage)
+        {
+            continue;
+        }
+        if (--it->second.refCount == 0)
+        {
+            destroyTexture(it->second.texture);
+            textures.erase(it);
+        }
+        return true;
+    }
+    return false;
+}
+
+// the settings of createTextureSampler
+VkSampler ResourceCache::acquireSampler()
+{
+    return acquireSampler(textureSamplerInfo(maxAnisotropy));
+}
+
+VkSampler ResourceCache::acquireSampler(const VkSamplerCreateInfo &info)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : samplers)
+    {
+        if (sameSamplerInfo(entry.info, info))
+        {
+            samplerHits++;
+            entry.refCount++;
+            return entry.sampler;
+        }
+    }
+    samplerMisses++;
+    VkSampler sampler;
+    if (vkCreateSampler(logicalDevice, &info, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture sampler!");
+    }
+    samplers.push_back(SamplerEntry{info, sampler, 1});
+    return sampler;
+}
+
+// false if the sampler didn't come from the cache
+bool ResourceCache::releaseSampler(VkSampler sampler)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = samplers.begin(); it != samplers.end(); it++)
+    {
+        if (it->sampler != sampler)
+        {
+            continue;
+        }
+        if (--it->refCount == 0)
+        {
+            vkDestroySampler(logicalDevice, sampler, nullptr);
+            samplers.erase(it);
+        }
+        return true;
+    }
+    return false;
+}
+
+void ResourceCache::destroyTexture(Texture texture)
+{
+    if (texture.bindlessIndex != NO_TEXTURE)
+    {
+        bindless->remove(texture.bindlessIndex);
+    }
+    vkDestroyImageView(logicalDevice, texture.imageView, nullptr);
+    vkDestroyImage(logicalDevice, texture.textureImage, nullptr);
+    vkFreeMemory(logicalDevice, texture.textureImageMemory, nullptr);
+}
+
+// destroys what is still referenced
+void ResourceCache::destroy()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &entry : textures)
+    {
+        destroyTexture(entry.second.texture);
+    }
+    textures.clear();
+    for (auto &entry : samplers)
+    {
+        vkDestroySampler(logicalDevice, entry.sampler, nullptr);
+    }
+    samplers.clear();
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef resource_cache_h
+#define resource_cache_h
+
+#include "common.cpp"
+#include "bindless.h"
+#include "commandPools.h"
+
+// refcounted textures keyed by asset name and samplers keyed by their create info, each is created once
+class ResourceCache
+{
+public:
+    uint64_t textureHits = 0;
+    uint64_t textureMisses = 0;
+    uint64_t samplerHits = 0;
+    uint64_t samplerMisses = 0;
+
+    void init(VkDevice logicalDevice, VkPhysicalDevice physicalDevice, CommandPools *commandPools, VkQueues queues, BindlessTextures *bindless);
+    Texture acquireTexture(std::string name);
+    bool releaseTexture(Texture texture);
+    VkSampler acquireSampler();
+    VkSampler acquireSampler(const VkSamplerCreateInfo &info);
+    bool releaseSampler(VkSampler sampler);
+    void destroy();
+
+private:
+    struct TextureEntry
+    {
+        Texture texture;
+        int refCount;
+    };
+
+    struct SamplerEntry
+    {
+        VkSamplerCreateInfo info;
+        VkSampler sampler;
+        int refCount;
+    };
+
+    VkDevice logicalDevice;
+    VkPhysicalDevice physicalDevice;
+    CommandPools *commandPools;
+    VkQueues queues;
+    BindlessTextures *bindless;
+    // queried once instead of for every sampler
+    float maxAnisotropy;
+    std::mutex mutex;
+    std::unordered_map<std::string, TextureEntry> textures;
+    std::vector<SamplerEntry> samplers;
+
+    void destroyTexture(Texture texture);
+};
+
+#endif
\ No newline at end of file
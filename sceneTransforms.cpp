@@ -0,0 +1,415 @@
+#include "common.cpp"
+#include "sceneTransforms.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SCENE_TRANSFORMS_SSE
+#endif
+
+void SceneTransforms::init(uint32_t capacity, std::vector<Buffer> frameBuffers, JobSystem *jobs)
+{
+    this->capacity = capacity;
+    this->frameBuffers = frameBuffers;
+    this->jobs = jobs;
+    staleHandles.resize(frameBuffers.size());
+    nodes.clear();
+    freeHandles.clear();
+}
+
+uint32_t SceneTransforms::indexOf(uint32_t handle) const
+{
+    if (handle >= nodes.size() || nodes[handle] == NO_NODE)
+    {
+        throw std::runtime_error("invalid scene node!");
+    }
+    return nodes[handle];
+}
+
+uint32_t SceneTransforms::create(uint32_t parent)
+{
+    uint32_t parentIndex = parent == NO_NODE ? NO_NODE : indexOf(parent);
+    uint32_t handle;
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        if (nodes.size() == capacity)
+        {
+            throw std::runtime_error("scene transform capacity exceeded!");
+        }
+        handle = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(NO_NODE);
+    }
+    nodes[handle] = static_cast<uint32_t>(handles.size());
+
+    parents.push_back(parentIndex);
+    translationX.push_back(0.0f);
+    translationY.push_back(0.0f);
+    translationZ.push_back(0.0f);
+    rotationX.push_back(0.0f);
+    rotationY.push_back(0.0f);
+    rotationZ.push_back(0.0f);
+    rotationW.push_back(1.0f);
+    scaleX.push_back(1.0f);
+    scaleY.push_back(1.0f);
+    scaleZ.push_back(1.0f);
+    dirty.push_back(1);
+    worlds.push_back(glm::mat4(1.0f));
+    handles.push_back(handle);
+    reorder = true;
+    anyDirty = true;
+    return handle;
+}
+
+// the handles of the descendants are freed by the next update, when they are found without a parent
+void SceneTransforms::remove(uint32_t node)
+{
+    uint32_t index = indexOf(node);
+    handles[index] = NO_NODE;
+    nodes[node] = NO_NODE;
+    freeHandles.push_back(node);
+    reorder = true;
+}
+
+void SceneTransforms::setParent(uint32_t node, uint32_t parent)
+{
+    uint32_t index = indexOf(node);
+    uint32_t parentIndex = parent == NO_NODE ? NO_NODE : indexOf(parent);
+    for (uint32_t ancestor = parentIndex; ancestor != NO_NODE; ancestor = parents[ancestor])
+    {
+        if (ancestor == index)
+        {
+            throw std::runtime_error("scene node can't become a child of itself!");
+        }
+    }
+    parents[index] = parentIndex;
+    dirty[index] = 1;
+    reorder = true;
+    anyDirty = true;
+}
+
+void SceneTransforms::setTranslation(uint32_t node, glm::vec3 translation)
+{
+    uint32_t index = indexOf(node);
+    translationX[index] = translation.x;
+    translationY[index] = translation.y;
+    translationZ[index] = translation.z;
+    dirty[index] = 1;
+    anyDirty = true;
+}
+
+void SceneTransforms::setRotation(uint32_t node, glm::vec4 rotation)
+{
+    uint32_t index = indexOf(node);
+    rotationX[index] = rotation.x;
+    rotationY[index] = rotation.y;
+    rotationZ[index] = rotation.z;
+    rotationW[index] = rotation.w;
+    dirty[index] = 1;
+    anyDirty = true;
+}
+
+void SceneTransforms::setScale(uint32_t node, glm::vec3 scale)
+{
+    uint32_t index = indexOf(node);
+    scaleX[index] = scale.x;
+    scaleY[index] = scale.y;
+    scaleZ[index] = scale.z;
+    dirty[index] = 1;
+    anyDirty = true;
+}
+
+const glm::mat4 &SceneTransforms::world(uint32_t node) const
+{
+    return worlds[indexOf(node)];
+}
+
+template <typename T>
+static void permute(std::vector<T> &values, const std::vector<uint32_t> &order)
+{
+    std::vector<T> sorted(order.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        sorted[i] = values[order[i]];
+    }
+    values.swap(sorted);
+}
+
+// breadth first from the roots, nodes below a destroyed one are never reached and dropped with it
+void SceneTransforms::sortNodes()
+{
+    uint32_t amountNodes = static_cast<uint32_t>(handles.size());
+    std::vector<uint32_t> childStart(amountNodes + 2, 0);
+    for (uint32_t i = 0; i < amountNodes; i++)
+    {
+        if (parents[i] != NO_NODE)
+        {
+            childStart[parents[i] + 2]++;
+        }
+    }
+    for (uint32_t i = 2; i < childStart.size(); i++)
+    {
+        childStart[i] += childStart[i - 1];
+    }
+    std::vector<uint32_t> children(childStart.back());
+    for (uint32_t i = 0; i < amountNodes; i++)
+    {
+        if (parents[i] != NO_NODE)
+        {
+            children[childStart[parents[i] + 1]++] = i;
+        }
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(amountNodes);
+    levels.clear();
+    for (uint32_t i = 0; i < amountNodes; i++)
+    {
+        if (parents[i] == NO_NODE && handles[i] != NO_NODE)
+        {
+            order.push_back(i);
+        }
+    }
+    size_t levelStart = 0;
+    while (levelStart < order.size())
+    {
+        size_t levelEnd = order.size();
+        levels.push_back(static_cast<uint32_t>(levelStart));
+        for (size_t i = levelStart; i < levelEnd; i++)
+        {
+            for (uint32_t c = childStart[order[i]]; c < childStart[order[i] + 1]; c++)
+            {
+                if (handles[children[c]] != NO_NODE)
+                {
+                    order.push_back(children[c]);
+                }
+            }
+        }
+        levelStart = levelEnd;
+    }
+    levels.push_back(static_cast<uint32_t>(order.size()));
+
+    std::vector<uint32_t> newIndex(amountNodes, NO_NODE);
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        newIndex[order[i]] = i;
+    }
+    for (uint32_t i = 0; i < amountNodes; i++)
+    {
+        if (newIndex[i] == NO_NODE && handles[i] != NO_NODE)
+        {
+            nodes[handles[i]] = NO_NODE;
+            freeHandles.push_back(handles[i]);
+        }
+    }
+
+    permute(parents, order);
+    for (auto &parent : parents)
+    {
+        if (parent != NO_NODE)
+        {
+            parent = newIndex[parent];
+        }
+    }
+    permute(translationX, order);
+    permute(translationY, order);
+    permute(translationZ, order);
+    permute(rotationX, order);
+    permute(rotationY, order);
+    permute(rotationZ, order);
+    permute(rotationW, order);
+    permute(scaleX, order);
+    permute(scaleY, order);
+    permute(scaleZ, order);
+    permute(dirty, order);
+    permute(worlds, order);
+    permute(handles, order);
+    for (uint32_t i = 0; i < handles.size(); i++)
+    {
+        nodes[handles[i]] = i;
+    }
+    reorder = false;
+}
+
+void SceneTransforms::update(uint32_t frame)
+{
+    if (reorder)
+    {
+        sortNodes();
+    }
+    auto *gpuWorlds = static_cast<glm::mat4 *>(frameBuffers[frame].memMap);
+    // whatever changed while the other frames were updated
+    for (uint32_t handle : staleHandles[frame])
+    {
+        if (nodes[handle] != NO_NODE)
+        {
+            gpuWorlds[handle] = worlds[nodes[handle]];
+        }
+    }
+    staleHandles[frame].clear();
+    updatedNodes = 0;
+    if (!anyDirty)
+    {
+        return;
+    }
+
+    // parents come first, so one pass marks every dirty subtree
+    uint32_t amountNodes = static_cast<uint32_t>(handles.size());
+    for (uint32_t i = 0; i < amountNodes; i++)
+    {
+        if (!dirty[i] && parents[i] != NO_NODE && dirty[parents[i]])
+        {
+            dirty[i] = 1;
+        }
+    }
+
+    // a depth only reads the matrices of the one before it, so its chunks are independent
+    std::function<void(uint32_t, uint32_t)> job = [this, gpuWorlds](uint32_t begin, uint32_t end)
+    {
+        updateNodes(begin, end, gpuWorlds);
+    };
+    for (size_t level = 0; level + 1 < levels.size(); level++)
+    {
+        jobs->parallelFor(levels[level], levels[level + 1], CHUNK_NODES, job);
+    }
+
+    for (uint32_t i = 0; i < amountNodes; i++)
+    {
+        if (!dirty[i])
+        {
+            continue;
+        }
+        dirty[i] = 0;
+        updatedNodes++;
+        for (uint32_t other = 0; other < staleHandles.size(); other++)
+        {
+            if (other != frame)
+            {
+                staleHandles[other].push_back(handles[i]);
+            }
+        }
+    }
+    anyDirty = false;
+}
+
+// world = parent world * translation * rotation * scale
+void SceneTransforms::updateNode(uint32_t index, glm::mat4 *gpuWorlds)
+{
+    float x = rotationX[index], y = rotationY[index], z = rotationZ[index], w = rotationW[index];
+    glm::mat4 local(1.0f);
+    local[0][0] = (1.0f - 2.0f * (y * y + z * z)) * scaleX[index];
+    local[0][1] = 2.0f * (x * y + w * z) * scaleX[index];
+    local[0][2] = 2.0f * (x * z - w * y) * scaleX[index];
+    local[1][0] = 2.0f * (x * y - w * z) * scaleY[index];
+    local[1][1] = (1.0f - 2.0f * (x * x + z * z)) * scaleY[index];
+    local[1][2] = 2.0f * (y * z + w * x) * scaleY[index];
+    local[2][0] = 2.0f * (x * z + w * y) * scaleZ[index];
+    local[2][1] = 2.0f * (y * z - w * x) * scaleZ[index];
+    local[2][2] = (1.0f - 2.0f * (x * x + y * y)) * scaleZ[index];
+    local[3][0] = translationX[index];
+    local[3][1] = translationY[index];
+    local[3][2] = translationZ[index];
+    worlds[index] = parents[index] == NO_NODE ? local : worlds[parents[index]] * local;
+    gpuWorlds[handles[index]] = worlds[index];
+}
+
+void SceneTransforms::updateNodes(uint32_t begin, uint32_t end, glm::mat4 *gpuWorlds)
+{
+    uint32_t i = begin;
+#ifdef SCENE_TRANSFORMS_SSE
+    // four nodes at a time straight from the arrays, the columns of their local matrices are transposed out afterwards
+    for (; i + 4 <= end; i += 4)
+    {
+        uint32_t anyDirty;
+        memcpy(&anyDirty, &dirty[i], sizeof(anyDirty));
+        if (!anyDirty)
+        {
+            continue;
+        }
+        __m128 x = _mm_loadu_ps(&rotationX[i]);
+        __m128 y = _mm_loadu_ps(&rotationY[i]);
+        __m128 z = _mm_loadu_ps(&rotationZ[i]);
+        __m128 w = _mm_loadu_ps(&rotationW[i]);
+        __m128 sx = _mm_loadu_ps(&scaleX[i]);
+        __m128 sy = _mm_loadu_ps(&scaleY[i]);
+        __m128 sz = _mm_loadu_ps(&scaleZ[i]);
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+        __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+        __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+        __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+        __m128 columns[4][4];
+        columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+        columns[0][1] = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+        columns[0][2] = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+        columns[0][3] = _mm_setzero_ps();
+        columns[1][0] = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+        columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+        columns[1][2] = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+        columns[1][3] = _mm_setzero_ps();
+        columns[2][0] = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+        columns[2][1] = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+        columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+        columns[2][3] = _mm_setzero_ps();
+        columns[3][0] = _mm_loadu_ps(&translationX[i]);
+        columns[3][1] = _mm_loadu_ps(&translationY[i]);
+        columns[3][2] = _mm_loadu_ps(&translationZ[i]);
+        columns[3][3] = one;
+        // afterwards columns[c][n] is column c of node i + n
+        for (int c = 0; c < 4; c++)
+        {
+            _MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+        }
+
+        for (uint32_t n = 0; n < 4; n++)
+        {
+            uint32_t index = i + n;
+            if (!dirty[index])
+            {
+                continue;
+            }
+            float *out = reinterpret_cast<float *>(&worlds[index]);
+            float *gpuOut = reinterpret_cast<float *>(&gpuWorlds[handles[index]]);
+            if (parents[index] == NO_NODE)
+            {
+                for (int c = 0; c < 4; c++)
+                {
+                    _mm_storeu_ps(out + c * 4, columns[c][n]);
+                    _mm_stream_ps(gpuOut + c * 4, columns[c][n]);
+                }
+                continue;
+            }
+            const float *parent = reinterpret_cast<const float *>(&worlds[parents[index]]);
+            __m128 parent0 = _mm_loadu_ps(parent);
+            __m128 parent1 = _mm_loadu_ps(parent + 4);
+            __m128 parent2 = _mm_loadu_ps(parent + 8);
+            __m128 parent3 = _mm_loadu_ps(parent + 12);
+            for (int c = 0; c < 4; c++)
+            {
+                __m128 column = columns[c][n];
+                __m128 result = _mm_mul_ps(parent0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+                result = _mm_add_ps(result, _mm_mul_ps(parent1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+                result = _mm_add_ps(result, _mm_mul_ps(parent2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+                result = _mm_add_ps(result, _mm_mul_ps(parent3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+                _mm_storeu_ps(out + c * 4, result);
+                _mm_stream_ps(gpuOut + c * 4, result);
+            }
+        }
+    }
+#endif
+    for (; i < end; i++)
+    {
+        if (dirty[i])
+        {
+            updateNode(i, gpuWorlds);
+        }
+    }
+#ifdef SCENE_TRANSFORMS_SSE
+    // streaming stores are weakly ordered, make them visible before the frame is submitted
+    _mm_sfence();
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef scene_transforms_h
+#define scene_transforms_h
+
+#include "common.cpp"
+#include "jobSystem.h"
+
+// parent/child transforms, the local translation, rotation and scale are kept as structure of arrays in breadth first
+// order, so every parent comes before its children and each depth of the tree is one contiguous range of nodes
+class SceneTransforms
+{
+public:
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    // nodes per chunk handed to a worker
+    static constexpr uint32_t CHUNK_NODES = 1024;
+
+    // world matrices recomputed by the last update
+    uint32_t updatedNodes = 0;
+    // per frame in flight, persistently mapped with one mat4 per handle, for shaders to index with the node handle
+    std::vector<Buffer> frameBuffers;
+
+    // see Vesuv::createSceneTransforms
+    void init(uint32_t capacity, std::vector<Buffer> frameBuffers, JobSystem *jobs);
+    // the handle stays valid until the node is destroyed, it is also the node's matrix index in the transform buffer
+    uint32_t create(uint32_t parent = NO_NODE);
+    // also destroys the node's descendants
+    void remove(uint32_t node);
+    void setParent(uint32_t node, uint32_t parent);
+    void setTranslation(uint32_t node, glm::vec3 translation);
+    // a unit quaternion as x, y, z, w
+    void setRotation(uint32_t node, glm::vec4 rotation);
+    void setScale(uint32_t node, glm::vec3 scale);
+    // as of the last update
+    const glm::mat4 &world(uint32_t node) const;
+    // recomputes the dirty subtrees and writes every matrix the frame's buffer is missing into it,
+    // the frame's previous use of its buffer must be finished, see Vesuv::updateSceneTransforms
+    void update(uint32_t frame);
+
+private:
+    uint32_t capacity = 0;
+    JobSystem *jobs = nullptr;
+    // per frame, handles whose matrices changed since the frame's buffer was written last
+    std::vector<std::vector<uint32_t>> staleHandles;
+
+    // per node
+    std::vector<uint32_t> parents;
+    std::vector<float> translationX, translationY, translationZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<uint8_t> dirty;
+    std::vector<glm::mat4> worlds;
+    // NO_NODE once destroyed
+    std::vector<uint32_t> handles;
+    // first node of every depth, followed by the amount of nodes
+    std::vector<uint32_t> levels;
+
+    // per handle, NO_NODE while unused
+    std::vector<uint32_t> nodes;
+    std::vector<uint32_t> freeHandles;
+    // nodes are appended and destroyed in place, the order is restored by the next update
+    bool reorder = false;
+    bool anyDirty = false;
+
+    uint32_t indexOf(uint32_t handle) const;
+    void sortNodes();
+    void updateNodes(uint32_t begin, uint32_t end, glm::mat4 *gpuWorlds);
+    void updateNode(uint32_t index, glm::mat4 *gpuWorlds);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,2 @@
+./scripts/compileShader.sh
+gcc -O2 -o overdraw benchmarks/overdraw.cpp $(ls *.cpp | grep -v main.cpp) -lvulkan -lglfw -lstdc++ -lc -ldl -lm -lpthread -lstb -lglm -llz4 && ./overdraw
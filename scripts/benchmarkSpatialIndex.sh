@@ -0,0 +1 @@
+gcc -O2 -o spatialIndex benchmarks/spatialIndex.cpp spatialIndex.cpp -lstdc++ -lm && ./spatialIndex
\ No newline at end of file
@@ -2,3 +2,15 @@ glslc -O -o ./shader/tri_fs.spv ./shader/tri.frag
 glslc -O -o ./shader/tri_vs.spv ./shader/tri.vert
 glslc -O -o ./shader/blue_fs.spv ./shader/blue.frag
 glslc -O -o ./shader/blue_vs.spv ./shader/blue.vert
+glslc -O --target-env=vulkan1.2 -o ./shader/bindless_fs.spv ./shader/bindless.frag
+glslc -O --target-env=vulkan1.2 -o ./shader/bindless_vs.spv ./shader/bindless.vert
+glslc -O -o ./shader/particles_cs.spv ./shader/particles.comp
+glslc -O -o ./shader/cull_cs.spv ./shader/cull.comp
+glslc -O -o ./shader/proxy_fs.spv ./shader/proxy.frag
+glslc -O -o ./shader/proxy_vs.spv ./shader/proxy.vert
+glslc -O -o ./shader/mesh_fs.spv ./shader/mesh.frag
+glslc -O -o ./shader/mesh_vs.spv ./shader/mesh.vert
+glslc -O --target-env=vulkan1.2 -o ./shader/sprite_fs.spv ./shader/sprite.frag
+glslc -O --target-env=vulkan1.2 -o ./shader/sprite_vs.spv ./shader/sprite.vert
+glslc -O -o ./shader/scene_fs.spv ./shader/scene.frag
+glslc -O -o ./shader/scene_vs.spv ./shader/scene.vert
\ No newline at end of file
@@ -0,0 +1 @@
+gcc -O2 -o packAssets tools/packAssets.cpp $(ls *.cpp | grep -v main.cpp) -lvulkan -lglfw -lstdc++ -lc -ldl -lm -lpthread -lstb -lglm -llz4 && ./packAssets "$@"
\ No newline at end of file
@@ -1,2 +1,2 @@
 time ./scripts/compileShader.sh
-time ccache gcc -o vesuv *.cpp -lvulkan -lglfw -lstdc++ -lc -ldl -lm -lstb -lglm && ./vesuv
\ No newline at end of file
+time ccache gcc -o vesuv *.cpp -lvulkan -lglfw -lstdc++ -lc -ldl -lm -lpthread -lstb -lglm -llz4 && ./vesuv
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "common.cpp"
+#include "shaderRegistry.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const uint32_t SPIRV_MAGIC = 0x07230203;
+
+static uint64_t hashContent(const uint8_t *data, size_t size)
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static VkShaderModule createShaderModule(const uint32_t *code, size_t size, VkDevice logicalDevice)
+{
+    VkShaderModuleCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.codeSize = size;
+    info.pCode = code;
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(logicalDevice, &info, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed shader module creation");
+    }
+    return shaderModule;
+}
+
+void ShaderRegistry::init(VkDevice logicalDevice)
+{
+    this->logicalDevice = logicalDevice;
+}
+
+// only the lookups and inserts hold the lock, reading, hashing and creating the module run in parallel across threads;
+// when two threads create the same module at once the later one drops its copy
+VkShaderModule ShaderRegistry::acquire(std::string path)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto knownPath = hashes.find(path);
+        if (knownPath != hashes.end())
+        {
+            auto &entry = modules[knownPath->second];
+            entry.refCount++;
+            return entry.module;
+        }
+    }
+
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        throw std::runtime_error("failed to open shader file " + path);
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size < 4 || info.st_size % 4 != 0)
+    {
+        close(file);
+        throw std::runtime_error("invalid SPIR-V size in " + path);
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    // the mapping is handed to the driver directly, no copy into a temporary buffer
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("failed to map shader file " + path);
+    }
+    auto code = static_cast<const uint32_t *>(mapping);
+    if (code[0] != SPIRV_MAGIC)
+    {
+        munmap(mapping, size);
+        throw std::runtime_error("not a SPIR-V file: " + path);
+    }
+
+    auto hash = hashContent(static_cast<const uint8_t *>(mapping), size);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto known = modules.find(hash);
+        if (known != modules.end())
+        {
+            known->second.refCount++;
+            hashes[path] = hash;
+            munmap(mapping, size);
+            return known->second.module;
+        }
+    }
+
+    VkShaderModule module;
+    try
+    {
+        module = createShaderModule(code, size, logicalDevice);
+    }
+    catch (...)
+    {
+        munmap(mapping, size);
+        throw;
+    }
+    munmap(mapping, size);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto known = modules.find(hash);
+    if (known != modules.end())
+    {
+        vkDestroyShaderModule(logicalDevice, module, nullptr);
+        known->second.refCount++;
+        hashes[path] = hash;
+        return known->second.module;
+    }
+    modules[hash] = Entry{module, 1};
+    hashes[path] = hash;
+    return module;
+}
+
+void ShaderRegistry::release(VkShaderModule module)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = modules.begin(); it != modules.end(); it++)
+    {
+        if (it->second.module != module)
+        {
+            continue;
+        }
+        if (--it->second.refCount == 0)
+        {
+            auto hash = it->first;
+            vkDestroyShaderModule(logicalDevice, module, nullptr);
+            modules.erase(it);
+            for (auto path = hashes.begin(); path != hashes.end();)
+            {
+                path = path->second == hash ? hashes.erase(path) : std::next(path);
+            }
+        }
+        return;
+    }
+}
+
+void ShaderRegistry::destroy()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &x : modules)
+    {
+        vkDestroyShaderModule(logicalDevice, x.second.module, nullptr);
+    }
+    modules.clear();
+    hashes.clear();
+}
@@ -0,0 +1,28 @@
+#ifndef shader_registry_h
+#define shader_registry_h
+
+#include "common.cpp"
+
+// refcounted VkShaderModules, keyed by path and by SPIR-V content hash so every module is created once
+class ShaderRegistry
+{
+public:
+    void init(VkDevice logicalDevice);
+    VkShaderModule acquire(std::string path);
+    void release(VkShaderModule module);
+    void destroy();
+
+private:
+    struct Entry
+    {
+        VkShaderModule module;
+        int refCount;
+    };
+
+    VkDevice logicalDevice;
+    std::mutex mutex;
+    std::unordered_map<std::string, uint64_t> hashes;
+    std::unordered_map<uint64_t, Entry> modules;
+};
+
+#endif
@@ -0,0 +1,379 @@
+#include "common.cpp"
+#include "spatialIndex.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPATIAL_INDEX_SSE
+#endif
+
+// a rectangle, or a convex region bounded by planes when amountPlanes isn't 0
+struct SpatialIndex::Query
+{
+    glm::vec4 rect;
+    const glm::vec3 *planes = nullptr;
+    uint32_t amountPlanes = 0;
+
+    static const int OUTSIDE = 0;
+    static const int OVERLAPS = 1;
+    static const int INSIDE = 2;
+
+    int classify(glm::vec4 box) const
+    {
+        if (amountPlanes == 0)
+        {
+            if (box.x > rect.z || box.z < rect.x || box.y > rect.w || box.w < rect.y)
+            {
+                return OUTSIDE;
+            }
+            return box.x >= rect.x && box.z <= rect.z && box.y >= rect.y && box.w <= rect.w ? INSIDE : OVERLAPS;
+        }
+        int result = INSIDE;
+        for (uint32_t i = 0; i < amountPlanes; i++)
+        {
+            auto &plane = planes[i];
+            float farthest = std::max(plane.x * box.x, plane.x * box.z) + std::max(plane.y * box.y, plane.y * box.w) + plane.z;
+            float nearest = std::min(plane.x * box.x, plane.x * box.z) + std::min(plane.y * box.y, plane.y * box.w) + plane.z;
+            if (farthest < 0.0f)
+            {
+                return OUTSIDE;
+            }
+            if (nearest < 0.0f)
+            {
+                result = OVERLAPS;
+            }
+        }
+        return result;
+    }
+
+    // one bit per object of the block that passes
+    int test(const Block &block) const
+    {
+#ifdef SPATIAL_INDEX_SSE
+        __m128 minX = _mm_load_ps(block.minX);
+        __m128 minY = _mm_load_ps(block.minY);
+        __m128 maxX = _mm_load_ps(block.maxX);
+        __m128 maxY = _mm_load_ps(block.maxY);
+        if (amountPlanes == 0)
+        {
+            __m128 pass = _mm_and_ps(_mm_cmple_ps(minX, _mm_set1_ps(rect.z)), _mm_cmpge_ps(maxX, _mm_set1_ps(rect.x)));
+            pass = _mm_and_ps(pass, _mm_cmple_ps(minY, _mm_set1_ps(rect.w)));
+            pass = _mm_and_ps(pass, _mm_cmpge_ps(maxY, _mm_set1_ps(rect.y)));
+            return _mm_movemask_ps(pass);
+        }
+        __m128 pass = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (uint32_t i = 0; i < amountPlanes; i++)
+        {
+            __m128 a = _mm_set1_ps(planes[i].x);
+            __m128 b = _mm_set1_ps(planes[i].y);
+            __m128 farthest = _mm_add_ps(_mm_max_ps(_mm_mul_ps(a, minX), _mm_mul_ps(a, maxX)), _mm_max_ps(_mm_mul_ps(b, minY), _mm_mul_ps(b, maxY)));
+            pass = _mm_and_ps(pass, _mm_cmpge_ps(_mm_add_ps(farthest, _mm_set1_ps(planes[i].z)), _mm_setzero_ps()));
+        }
+        return _mm_movemask_ps(pass);
+#else
+        int mask = 0;
+        for (int lane = 0; lane < 4; lane++)
+        {
+            glm::vec4 box(block.minX[lane], block.minY[lane], block.maxX[lane], block.maxY[lane]);
+            mask |= classify(box) != OUTSIDE ? 1 << lane : 0;
+        }
+        return mask;
+#endif
+    }
+};
+
+void SpatialIndex::init(glm::vec4 worldBounds, uint32_t amountLevels)
+{
+    if (amountLevels == 0 || amountLevels > 12)
+    {
+        throw std::runtime_error("spatial index needs between 1 and 12 levels!");
+    }
+    this->worldBounds = worldBounds;
+    this->amountLevels = amountLevels;
+    cellSizes.clear();
+    levelStart.clear();
+    uint32_t amountCells = 0;
+    for (uint32_t level = 0; level < amountLevels; level++)
+    {
+        float cellsPerSide = static_cast<float>(1u << level);
+        cellSizes.push_back(glm::vec2((worldBounds.z - worldBounds.x) / cellsPerSide, (worldBounds.w - worldBounds.y) / cellsPerSide));
+        levelStart.push_back(amountCells);
+        amountCells += 1u << (2 * level);
+    }
+    cells.assign(amountCells, Cell{});
+    blocks.clear();
+    freeBlocks.clear();
+    entries.clear();
+    freeObjects.clear();
+    amountObjects = 0;
+}
+
+uint32_t SpatialIndex::findCell(glm::vec4 rect) const
+{
+    float width = rect.z - rect.x;
+    float height = rect.w - rect.y;
+    uint32_t level = amountLevels - 1;
+    while (level > 0 && (width > cellSizes[level].x || height > cellSizes[level].y))
+    {
+        level--;
+    }
+    if (level == 0)
+    {
+        return 0;
+    }
+    float cellsPerSide = static_cast<float>(1u << level);
+    float x = ((rect.x + rect.z) * 0.5f - worldBounds.x) / cellSizes[level].x;
+    float y = ((rect.y + rect.w) * 0.5f - worldBounds.y) / cellSizes[level].y;
+    // also catches NaN
+    if (!(x >= 0.0f && x < cellsPerSide && y >= 0.0f && y < cellsPerSide))
+    {
+        return 0;
+    }
+    return levelStart[level] + static_cast<uint32_t>(y) * (1u << level) + static_cast<uint32_t>(x);
+}
+
+void SpatialIndex::countObjects(uint32_t cell, int32_t change)
+{
+    uint32_t level = amountLevels - 1;
+    while (levelStart[level] > cell)
+    {
+        level--;
+    }
+    uint32_t x = (cell - levelStart[level]) % (1u << level);
+    uint32_t y = (cell - levelStart[level]) / (1u << level);
+    while (true)
+    {
+        cells[levelStart[level] + y * (1u << level) + x].subtreeObjects += change;
+        if (level == 0)
+        {
+            return;
+        }
+        level--;
+        x >>= 1;
+        y >>= 1;
+    }
+}
+
+static void writeLane(void *block, uint32_t lane, glm::vec4 rect)
+{
+    float *values = static_cast<float *>(block);
+    values[lane] = rect.x;
+    values[4 + lane] = rect.y;
+    values[8 + lane] = rect.z;
+    values[12 + lane] = rect.w;
+}
+
+void SpatialIndex::addToCell(uint32_t object, uint32_t cell, glm::vec4 rect)
+{
+    auto &target = cells[cell];
+    uint32_t slot = static_cast<uint32_t>(target.objects.size());
+    if (slot % 4 == 0)
+    {
+        if (!freeBlocks.empty())
+        {
+            target.blocks.push_back(freeBlocks.back());
+            freeBlocks.pop_back();
+        }
+        else
+        {
+            target.blocks.push_back(static_cast<uint32_t>(blocks.size()));
+            blocks.push_back(Block{});
+        }
+    }
+    uint32_t block = target.blocks[slot / 4];
+    writeLane(&blocks[block], slot % 4, rect);
+    target.objects.push_back(object);
+    entries[object] = Entry{cell, slot, block};
+    countObjects(cell, 1);
+}
+
+// the cell's last object takes over the slot
+void SpatialIndex::removeFromCell(uint32_t object)
+{
+    auto &entry = entries[object];
+    auto &source = cells[entry.cell];
+    uint32_t last = static_cast<uint32_t>(source.objects.size()) - 1;
+    if (entry.slot != last)
+    {
+        auto &from = blocks[source.blocks[last / 4]];
+        uint32_t lane = last % 4;
+        writeLane(&blocks[entry.block], entry.slot % 4, glm::vec4(from.minX[lane], from.minY[lane], from.maxX[lane], from.maxY[lane]));
+        uint32_t moved = source.objects[last];
+        source.objects[entry.slot] = moved;
+        entries[moved].slot = entry.slot;
+        entries[moved].block = entry.block;
+    }
+    source.objects.pop_back();
+    if (last % 4 == 0)
+    {
+        freeBlocks.push_back(source.blocks.back());
+        source.blocks.pop_back();
+    }
+    countObjects(entry.cell, -1);
+}
+
+uint32_t SpatialIndex::insert(glm::vec4 rect)
+{
+    uint32_t object;
+    if (!freeObjects.empty())
+    {
+        object = freeObjects.back();
+        freeObjects.pop_back();
+    }
+    else
+    {
+        object = static_cast<uint32_t>(entries.size());
+        entries.push_back(Entry{NO_OBJECT, 0, 0});
+    }
+    addToCell(object, findCell(rect), rect);
+    amountObjects++;
+    return object;
+}
+
+// only moves to another cell once the object's center leaves its cell or its size changes level
+void SpatialIndex::move(uint32_t object, glm::vec4 rect)
+{
+    if (object >= entries.size() || entries[object].cell == NO_OBJECT)
+    {
+        throw std::runtime_error("invalid spatial index object!");
+    }
+    uint32_t cell = findCell(rect);
+    auto &entry = entries[object];
+    if (cell != entry.cell)
+    {
+        removeFromCell(object);
+        addToCell(object, cell, rect);
+        return;
+    }
+    writeLane(&blocks[entry.block], entry.slot % 4, rect);
+}
+
+void SpatialIndex::remove(uint32_t object)
+{
+    if (object >= entries.size() || entries[object].cell == NO_OBJECT)
+    {
+        throw std::runtime_error("invalid spatial index object!");
+    }
+    removeFromCell(object);
+    entries[object].cell = NO_OBJECT;
+    freeObjects.push_back(object);
+    amountObjects--;
+}
+
+glm::vec4 SpatialIndex::bounds(uint32_t object) const
+{
+    auto &entry = entries[object];
+    auto &block = blocks[entry.block];
+    uint32_t lane = entry.slot % 4;
+    return glm::vec4(block.minX[lane], block.minY[lane], block.maxX[lane], block.maxY[lane]);
+}
+
+uint32_t SpatialIndex::size() const
+{
+    return amountObjects;
+}
+
+// everything in the subtree, for cells entirely inside the query
+void SpatialIndex::collect(uint32_t level, uint32_t x, uint32_t y, std::vector<uint32_t> &results) const
+{
+    auto &cell = cells[levelStart[level] + y * (1u << level) + x];
+    if (cell.subtreeObjects == 0)
+    {
+        return;
+    }
+    results.insert(results.end(), cell.objects.begin(), cell.objects.end());
+    if (level + 1 < amountLevels)
+    {
+        for (uint32_t child = 0; child < 4; child++)
+        {
+            collect(level + 1, x * 2 + (child & 1), y * 2 + (child >> 1), results);
+        }
+    }
+}
+
+void SpatialIndex::query(const Query &shape, uint32_t level, uint32_t x, uint32_t y, std::vector<uint32_t> &results) const
+{
+    auto &cell = cells[levelStart[level] + y * (1u << level) + x];
+    if (cell.subtreeObjects == 0)
+    {
+        return;
+    }
+    // the root also holds whatever is outside the world, so it has no bounds to test
+    if (level > 0)
+    {
+        glm::vec2 size = cellSizes[level];
+        float minX = worldBounds.x + (static_cast<float>(x) - 0.5f) * size.x;
+        float minY = worldBounds.y + (static_cast<float>(y) - 0.5f) * size.y;
+        int overlap = shape.classify(glm::vec4(minX, minY, minX + 2.0f * size.x, minY + 2.0f * size.y));
+        if (overlap == Query::OUTSIDE)
+        {
+            return;
+        }
+        if (overlap == Query::INSIDE)
+        {
+            collect(level, x, y, results);
+            return;
+        }
+    }
+
+    uint32_t amount = static_cast<uint32_t>(cell.objects.size());
+    for (uint32_t b = 0; b < cell.blocks.size(); b++)
+    {
+        int mask = shape.test(blocks[cell.blocks[b]]);
+        // the last block's unused lanes hold stale bounds
+        if (b * 4 + 4 > amount)
+        {
+            mask &= (1 << (amount - b * 4)) - 1;
+        }
+        for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1)
+        {
+            if (mask & 1)
+            {
+                results.push_back(cell.objects[b * 4 + lane]);
+            }
+        }
+    }
+    if (level + 1 < amountLevels)
+    {
+        for (uint32_t child = 0; child < 4; child++)
+        {
+            query(shape, level + 1, x * 2 + (child & 1), y * 2 + (child >> 1), results);
+        }
+    }
+}
+
+void SpatialIndex::queryRect(glm::vec4 rect, std::vector<uint32_t> &results) const
+{
+    Query shape;
+    shape.rect = rect;
+    query(shape, 0, 0, 0, results);
+}
+
+void SpatialIndex::queryPoint(glm::vec2 point, std::vector<uint32_t> &results) const
+{
+    queryRect(glm::vec4(point.x, point.y, point.x, point.y), results);
+}
+
+void SpatialIndex::queryPlanes(const glm::vec3 *planes, uint32_t amountPlanes, std::vector<uint32_t> &results) const
+{
+    Query shape;
+    shape.planes = planes;
+    shape.amountPlanes = amountPlanes;
+    query(shape, 0, 0, 0, results);
+}
+
+// left, right, bottom and top plane from the rows of the matrix, with z = 0 the z column drops out
+void SpatialIndex::queryFrustum(const glm::mat4 &viewProjection, std::vector<uint32_t> &results) const
+{
+    glm::vec3 planes[4];
+    for (int row = 0; row < 2; row++)
+    {
+        for (int side = 0; side < 2; side++)
+        {
+            float sign = side == 0 ? 1.0f : -1.0f;
+            planes[row * 2 + side] = glm::vec3(viewProjection[0][3] + sign * viewProjection[0][row],
+                                               viewProjection[1][3] + sign * viewProjection[1][row],
+                                               viewProjection[3][3] + sign * viewProjection[3][row]);
+        }
+    }
+    queryPlanes(planes, 4, results);
+}
\ No newline at end of file
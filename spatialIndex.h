@@ -0,0 +1,83 @@
+#ifndef spatial_index_h
+#define spatial_index_h
+
+#include "common.cpp"
+
+// loose quadtree over 2D rectangles given as min x, min y, max x, max y. an object lives in the cell of the deepest level
+// that is at least as large as the object and contains its center, the cells' bounds are grown by half a cell on every
+// side so that always holds. the levels are full grids, so finding an object's cell needs no descent
+class SpatialIndex
+{
+public:
+    static constexpr uint32_t NO_OBJECT = UINT32_MAX;
+
+    // objects outside of worldBounds still work, they are kept at the root and tested by every query
+    void init(glm::vec4 worldBounds, uint32_t amountLevels = 8);
+    // the id stays valid until the object is removed
+    uint32_t insert(glm::vec4 rect);
+    void move(uint32_t object, glm::vec4 rect);
+    void remove(uint32_t object);
+    glm::vec4 bounds(uint32_t object) const;
+    uint32_t size() const;
+
+    // the results are appended
+    void queryRect(glm::vec4 rect, std::vector<uint32_t> &results) const;
+    void queryPoint(glm::vec2 point, std::vector<uint32_t> &results) const;
+    // objects on the inner side of every plane, a plane (a, b, c) keeps what satisfies a * x + b * y + c >= 0
+    void queryPlanes(const glm::vec3 *planes, uint32_t amountPlanes, std::vector<uint32_t> &results) const;
+    // the side planes of the view frustum where they cut z = 0
+    void queryFrustum(const glm::mat4 &viewProjection, std::vector<uint32_t> &results) const;
+
+private:
+    // four objects' bounds as structure of arrays
+    struct alignas(16) Block
+    {
+        float minX[4];
+        float minY[4];
+        float maxX[4];
+        float maxY[4];
+    };
+
+    struct Cell
+    {
+        // into the block pool, slot i of the cell is lane i % 4 of blocks[i / 4]
+        std::vector<uint32_t> blocks;
+        std::vector<uint32_t> objects;
+        // in the cell and all cells below it, so empty subtrees are skipped
+        uint32_t subtreeObjects = 0;
+    };
+
+    // where an object is, cell is NO_OBJECT while the id is free
+    struct Entry
+    {
+        uint32_t cell;
+        uint32_t slot;
+        uint32_t block;
+    };
+
+    struct Query;
+
+    glm::vec4 worldBounds;
+    uint32_t amountLevels = 0;
+    // per level, the size of a cell and the index of the level's first cell, level l is a grid of 2^l by 2^l cells
+    std::vector<glm::vec2> cellSizes;
+    std::vector<uint32_t> levelStart;
+    std::vector<Cell> cells;
+    // shared by all cells, so moving an object within its cell only touches its own block
+    std::vector<Block> blocks;
+    std::vector<uint32_t> freeBlocks;
+
+    // per object id
+    std::vector<Entry> entries;
+    std::vector<uint32_t> freeObjects;
+    uint32_t amountObjects = 0;
+
+    uint32_t findCell(glm::vec4 rect) const;
+    void addToCell(uint32_t object, uint32_t cell, glm::vec4 rect);
+    void removeFromCell(uint32_t object);
+    void countObjects(uint32_t cell, int32_t change);
+    void query(const Query &shape, uint32_t level, uint32_t x, uint32_t y, std::vector<uint32_t> &results) const;
+    void collect(uint32_t level, uint32_t x, uint32_t y, std::vector<uint32_t> &results) const;
+};
+
+#endif
\ No newline at end of file
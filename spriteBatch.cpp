@@ -0,0 +1,197 @@
+#include "common.cpp"
+#include "spriteBatch.h"
+#include "vkMemory.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPRITE_BATCH_SSE
+#endif
+
+void SpriteBatch::init(int framesInFlight, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueues queues)
+{
+    this->logicalDevice = logicalDevice;
+    this->physicalDevice = physicalDevice;
+    this->frames.resize(framesInFlight);
+
+    std::vector<uint16_t> indices(CHUNK_SPRITES * 6);
+    for (uint32_t i = 0; i < CHUNK_SPRITES; i++)
+    {
+        uint16_t first = static_cast<uint16_t>(i * 4);
+        uint16_t quad[] = {first, static_cast<uint16_t>(first + 1), static_cast<uint16_t>(first + 2), static_cast<uint16_t>(first + 2), static_cast<uint16_t>(first + 3), first};
+        memcpy(&indices[i * 6], quad, sizeof(quad));
+    }
+    VkDeviceSize bufferSize = indices.size() * sizeof(uint16_t);
+    auto stagingBuffer = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+    void *data;
+    vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, indices.data(), bufferSize);
+    vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
+
+    quadIndices = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, logicalDevice, physicalDevice);
+    quadIndices.amountElements = static_cast<int>(indices.size());
+    quadIndices.indexType = VK_INDEX_TYPE_UINT16;
+    copyBuffer(stagingBuffer.buffer, quadIndices.buffer, bufferSize, logicalDevice, commandPool, queues);
+    vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
+    vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
+}
+
+void SpriteBatch::begin(uint32_t frame, const glm::mat3 &projection)
+{
+    this->frame = frame;
+    this->projection = projection;
+    runs.clear();
+    amountSprites = 0;
+    useChunk(0);
+}
+
+// continues writing at the start of the frame's chunk, creating it on first use
+void SpriteBatch::useChunk(uint32_t index)
+{
+    chunk = index;
+    spritesInChunk = 0;
+    auto &chunks = frames[frame];
+    if (index < chunks.size())
+    {
+        chunkVertices = static_cast<BatchVertex *>(chunks[index].memMap);
+        return;
+    }
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(CHUNK_SPRITES) * 4 * sizeof(BatchVertex);
+    auto buffer = createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+    vkMapMemory(logicalDevice, buffer.bufferMemory, 0, bufferSize, 0, &buffer.memMap);
+    buffer.amountElements = CHUNK_SPRITES * 4;
+    chunks.push_back(buffer);
+    chunkVertices = static_cast<BatchVertex *>(buffer.memMap);
+}
+
+void SpriteBatch::setPipeline(const GraphicsPipeline &pipeline, VkDescriptorSet descriptorSet)
+{
+    this->pipeline = pipeline.pipeline;
+    this->layout = pipeline.layout;
+    this->descriptorSet = descriptorSet;
+}
+
+void SpriteBatch::setTexture(uint32_t textureIndex)
+{
+    this->textureIndex = textureIndex;
+}
+
+static uint32_t packUnorm16x2(uint32_t u, uint32_t v)
+{
+    return u | v << 16;
+}
+
+static uint32_t packUnorm8x4(glm::vec4 color)
+{
+    return static_cast<uint32_t>(floatToUnorm8(color.x)) | static_cast<uint32_t>(floatToUnorm8(color.y)) << 8 |
+           static_cast<uint32_t>(floatToUnorm8(color.z)) << 16 | static_cast<uint32_t>(floatToUnorm8(color.w)) << 24;
+}
+
+// corners in the order 0 1 2 3 = top left, top right, bottom right, bottom left, see the quad indices in init
+void SpriteBatch::drawSprite(glm::vec4 rect, glm::vec4 uv, glm::vec4 color, const glm::mat3 &transform)
+{
+    if (spritesInChunk == CHUNK_SPRITES)
+    {
+        useChunk(chunk + 1);
+    }
+    if (runs.empty() || runs.back().pipeline != pipeline || runs.back().layout != layout || runs.back().descriptorSet != descriptorSet ||
+        runs.back().textureIndex != textureIndex || runs.back().chunk != chunk)
+    {
+        runs.push_back(Run{pipeline, layout, descriptorSet, textureIndex, chunk, spritesInChunk, 0});
+    }
+
+    // projection * transform, both affine so only the upper two rows are needed
+    float m00 = projection[0][0] * transform[0][0] + projection[1][0] * transform[0][1];
+    float m01 = projection[0][1] * transform[0][0] + projection[1][1] * transform[0][1];
+    float m10 = projection[0][0] * transform[1][0] + projection[1][0] * transform[1][1];
+    float m11 = projection[0][1] * transform[1][0] + projection[1][1] * transform[1][1];
+    float m20 = projection[0][0] * transform[2][0] + projection[1][0] * transform[2][1] + projection[2][0];
+    float m21 = projection[0][1] * transform[2][0] + projection[1][1] * transform[2][1] + projection[2][1];
+
+    float x0 = rect.x, y0 = rect.y, x1 = rect.x + rect.z, y1 = rect.y + rect.w;
+    uint32_t colorWord = packUnorm8x4(color);
+    uint32_t u0 = floatToUnorm16(uv.x), v0 = floatToUnorm16(uv.y), u1 = floatToUnorm16(uv.z), v1 = floatToUnorm16(uv.w);
+    uint32_t uv0 = packUnorm16x2(u0, v0);
+    uint32_t uv1 = packUnorm16x2(u1, v0);
+    uint32_t uv2 = packUnorm16x2(u1, v1);
+    uint32_t uv3 = packUnorm16x2(u0, v1);
+
+    float *out = reinterpret_cast<float *>(chunkVertices + spritesInChunk * 4);
+#ifdef SPRITE_BATCH_SSE
+    // all four corners at once, the vertices are written as whole 16 byte lines bypassing the cache
+    __m128 xs = _mm_setr_ps(x0, x1, x1, x0);
+    __m128 ys = _mm_setr_ps(y0, y0, y1, y1);
+    __m128 outX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m00), xs), _mm_mul_ps(_mm_set1_ps(m10), ys)), _mm_set1_ps(m20));
+    __m128 outY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m01), xs), _mm_mul_ps(_mm_set1_ps(m11), ys)), _mm_set1_ps(m21));
+    __m128 positions01 = _mm_unpacklo_ps(outX, outY);
+    __m128 positions23 = _mm_unpackhi_ps(outX, outY);
+    __m128 attributes01 = _mm_castsi128_ps(_mm_setr_epi32(static_cast<int>(uv0), static_cast<int>(colorWord), static_cast<int>(uv1), static_cast<int>(colorWord)));
+    __m128 attributes23 = _mm_castsi128_ps(_mm_setr_epi32(static_cast<int>(uv2), static_cast<int>(colorWord), static_cast<int>(uv3), static_cast<int>(colorWord)));
+    _mm_stream_ps(out, _mm_movelh_ps(positions01, attributes01));
+    _mm_stream_ps(out + 4, _mm_movehl_ps(attributes01, positions01));
+    _mm_stream_ps(out + 8, _mm_movelh_ps(positions23, attributes23));
+    _mm_stream_ps(out + 12, _mm_movehl_ps(attributes23, positions23));
+#else
+    float xs[] = {x0, x1, x1, x0};
+    float ys[] = {y0, y0, y1, y1};
+    uint32_t uvs[] = {uv0, uv1, uv2, uv3};
+    for (int i = 0; i < 4; i++)
+    {
+        out[i * 4] = m00 * xs[i] + m10 * ys[i] + m20;
+        out[i * 4 + 1] = m01 * xs[i] + m11 * ys[i] + m21;
+        memcpy(&out[i * 4 + 2], &uvs[i], sizeof(uint32_t));
+        memcpy(&out[i * 4 + 3], &colorWord, sizeof(uint32_t));
+    }
+#endif
+
+    spritesInChunk++;
+    amountSprites++;
+    runs.back().amountSprites++;
+}
+
+void SpriteBatch::drawSprite(const AtlasRegion &region, glm::vec4 rect, glm::vec4 color, const glm::mat3 &transform)
+{
+    setTexture(region.textureIndex);
+    drawSprite(rect, glm::vec4(region.uvMin.x, region.uvMin.y, region.uvMax.x, region.uvMax.y), color, transform);
+}
+
+// the draws are only valid for the frame passed to begin
+std::vector<DrawCommand> SpriteBatch::end()
+{
+#ifdef SPRITE_BATCH_SSE
+    // streaming stores are weakly ordered, make them visible before the frame is submitted
+    _mm_sfence();
+#endif
+    std::vector<DrawCommand> draws(runs.size());
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        auto &run = runs[i];
+        auto &draw = draws[i];
+        draw.pipeline = run.pipeline;
+        draw.layout = run.layout;
+        draw.descriptorSet = run.descriptorSet;
+        draw.textureIndex = run.textureIndex;
+        draw.vertexBuffer = frames[frame][run.chunk];
+        draw.indexBuffer = quadIndices;
+        draw.indexCount = run.amountSprites * 6;
+        draw.vertexOffset = static_cast<int32_t>(run.firstSprite * 4);
+        // blended in the order they were drawn, sortDrawCommands keeps that order for transparent draws at equal depth
+        draw.opaque = false;
+    }
+    return draws;
+}
+
+void SpriteBatch::destroy()
+{
+    for (auto &chunks : frames)
+    {
+        for (auto &buffer : chunks)
+        {
+            vkUnmapMemory(logicalDevice, buffer.bufferMemory);
+            vkDestroyBuffer(logicalDevice, buffer.buffer, nullptr);
+            vkFreeMemory(logicalDevice, buffer.bufferMemory, nullptr);
+        }
+    }
+    frames.clear();
+    vkDestroyBuffer(logicalDevice, quadIndices.buffer, nullptr);
+    vkFreeMemory(logicalDevice, quadIndices.bufferMemory, nullptr);
+}
\ No newline at end of file
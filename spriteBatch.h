@@ -0,0 +1,62 @@
+#ifndef sprite_batch_h
+#define sprite_batch_h
+
+#include "common.cpp"
+#include "vertex.h"
+
+// immediate mode sprites: quads go straight into persistently mapped per-frame vertex memory, every run of
+// sprites sharing pipeline, descriptor set and texture becomes one indexed draw against a shared quad index buffer
+class SpriteBatch
+{
+public:
+    // sprites per vertex buffer chunk, their vertices just fit 16 bit indices
+    static const uint32_t CHUNK_SPRITES = 16384;
+
+    // sprites written since begin
+    uint32_t amountSprites = 0;
+
+    void init(int framesInFlight, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueues queues);
+    // the frame's previous use of its vertex memory must be finished, see Vesuv::beginSprites
+    void begin(uint32_t frame, const glm::mat3 &projection);
+    void setPipeline(const GraphicsPipeline &pipeline, VkDescriptorSet descriptorSet = VK_NULL_HANDLE);
+    void setTexture(uint32_t textureIndex);
+    // rect is x, y, width, height and uv is u0, v0, u1, v1; transform is a 2D affine matrix applied before the projection
+    void drawSprite(glm::vec4 rect, glm::vec4 uv, glm::vec4 color, const glm::mat3 &transform);
+    void drawSprite(const AtlasRegion &region, glm::vec4 rect, glm::vec4 color, const glm::mat3 &transform);
+    std::vector<DrawCommand> end();
+    void destroy();
+
+private:
+    struct Run
+    {
+        VkPipeline pipeline;
+        VkPipelineLayout layout;
+        VkDescriptorSet descriptorSet;
+        uint32_t textureIndex;
+        uint32_t chunk;
+        uint32_t firstSprite;
+        uint32_t amountSprites;
+    };
+
+    VkDevice logicalDevice;
+    VkPhysicalDevice physicalDevice;
+    // 6 indices per quad for CHUNK_SPRITES quads
+    Buffer quadIndices;
+    // per frame in flight, grown when a frame needs more chunks and kept for later frames
+    std::vector<std::vector<Buffer>> frames;
+    uint32_t frame = 0;
+    glm::mat3 projection;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    uint32_t textureIndex = NO_TEXTURE;
+    std::vector<Run> runs;
+    uint32_t chunk = 0;
+    BatchVertex *chunkVertices = nullptr;
+    uint32_t spritesInChunk = 0;
+
+    void useChunk(uint32_t index);
+};
+
+#endif
\ No newline at end of file
@@ -122,16 +122,28 @@ SwapChain createSwapChain(VkPhysicalDevice physicalDevice, VkDevice logicalDevic
     return swapChain;
 }
 
+// one depth image shared by all framebuffers and frames in flight; that is safe because every frame is submitted to
+// the same graphics queue and the render pass' external dependency orders one frame's depth writes before the next
+void createDepthResources(SwapChain &swapchain, VkPhysicalDevice physicalDevice, VkDevice logicalDevice)
+{
+    if (swapchain.depthFormat == VK_FORMAT_UNDEFINED)
+    {
+        return;
+    }
+    createImage(swapchain.extent.width, swapchain.extent.height, swapchain.depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapchain.depthImage, swapchain.depthImageMemory, logicalDevice, physicalDevice);
+    swapchain.depthImageView = createImageView(swapchain.depthImage, swapchain.depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, logicalDevice);
+}
+
 void createFramebuffers(SwapChain &swapchain, VkRenderPass renderPass, VkDevice logicalDevice)
 {
     swapchain.framebuffers.resize(swapchain.images.size());
     for (int i = 0; i < swapchain.framebuffers.size(); i++)
     {
-        VkImageView attachments[] = {swapchain.imageViews[i]};
+        VkImageView attachments[] = {swapchain.imageViews[i], swapchain.depthImageView};
         VkFramebufferCreateInfo info{};
         info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         info.renderPass = renderPass;
-        info.attachmentCount = 1;
+        info.attachmentCount = swapchain.depthFormat != VK_FORMAT_UNDEFINED ? 2 : 1;
         info.pAttachments = attachments;
         info.width = swapchain.extent.width;
         info.height = swapchain.extent.height;
@@ -153,21 +165,11 @@ void cleanupSwapChain(SwapChain &swapChain, VkDevice logicalDevice)
     {
         vkDestroyImageView(logicalDevice, swapChain.imageViews[i], nullptr);
     }
-    vkDestroySwapchainKHR(logicalDevice, swapChain.swapchain, nullptr);
-}
-void recreateSwapChain(GLFWwindow *window, VkDevice logicalDevice, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, SwapChain &swapChain, VkRenderPass renderPass)
-{
-    int width = 0, height = 0;
-    glfwGetFramebufferSize(window, &width, &height);
-    while (width == 0 || height == 0)
+    if (swapChain.depthFormat != VK_FORMAT_UNDEFINED)
     {
-        glfwGetFramebufferSize(window, &width, &height);
-        glfwWaitEvents();
+        vkDestroyImageView(logicalDevice, swapChain.depthImageView, nullptr);
+        vkDestroyImage(logicalDevice, swapChain.depthImage, nullptr);
+        vkFreeMemory(logicalDevice, swapChain.depthImageMemory, nullptr);
     }
-
-    vkDeviceWaitIdle(logicalDevice);
-    cleanupSwapChain(swapChain, logicalDevice);
-
-    createSwapChain(physicalDevice, logicalDevice, surface, window);
-    createFramebuffers(swapChain, renderPass, logicalDevice);
+    vkDestroySwapchainKHR(logicalDevice, swapChain.swapchain, nullptr);
 }
\ No newline at end of file
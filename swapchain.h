@@ -4,8 +4,8 @@
 #include "common.cpp"
 
 SwapChain createSwapChain(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkSurfaceKHR surface, GLFWwindow *window);
+void createDepthResources(SwapChain &swapchain, VkPhysicalDevice physicalDevice, VkDevice logicalDevice);
 void createFramebuffers(SwapChain &swapchain, VkRenderPass renderPass, VkDevice logicalDevice);
 void cleanupSwapChain(SwapChain &swapChain, VkDevice logicalDevice);
-void recreateSwapChain(GLFWwindow *window, VkDevice logicalDevice, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, SwapChain &swapChain, VkRenderPass renderPass);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "common.cpp"
+#include "textureAtlas.h"
+#include "commands.h"
+#include "vkMemory.h"
+#include "image.h"
+
+void TextureAtlas::init(uint32_t pageSize, uint32_t padding, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, CommandPools *commandPools, VkQueues queues, BindlessTextures *bindless)
+{
+    this->pageSize = pageSize;
+    this->padding = padding;
+    this->logicalDevice = logicalDevice;
+    this->physicalDevice = physicalDevice;
+    this->commandPools = commandPools;
+    this->queues = queues;
+    this->bindless = bindless;
+}
+
+// the lowest y at which a width wide rectangle starting at the node fits
+bool TextureAtlas::fit(const std::vector<SkylineNode> &skyline, size_t index, uint32_t width, uint32_t height, uint32_t &y)
+{
+    if (skyline[index].x + width > pageSize)
+    {
+        return false;
+    }
+    y = 0;
+    int64_t widthLeft = width;
+    for (size_t i = index; widthLeft > 0; i++)
+    {
+        y = std::max(y, skyline[i].y);
+        if (y + height > pageSize)
+        {
+            return false;
+        }
+        widthLeft -= skyline[i].width;
+    }
+    return true;
+}
+
+// bottom left heuristic: lowest top edge, then the narrowest node
+bool TextureAtlas::pack(std::vector<SkylineNode> &skyline, uint32_t width, uint32_t height, uint32_t &x, uint32_t &y)
+{
+    size_t best = skyline.size();
+    uint32_t bestTop = UINT32_MAX, bestWidth = UINT32_MAX;
+    for (size_t i = 0; i < skyline.size(); i++)
+    {
+        uint32_t top;
+        if (fit(skyline, i, width, height, top) && (top + height < bestTop || (top + height == bestTop && skyline[i].width < bestWidth)))
+        {
+            best = i;
+            bestTop = top + height;
+            bestWidth = skyline[i].width;
+        }
+    }
+    if (best == skyline.size())
+    {
+        return false;
+    }
+    x = skyline[best].x;
+    y = bestTop - height;
+
+    // the new node covers the rectangle, the nodes below it shrink or disappear
+    skyline.insert(skyline.begin() + best, SkylineNode{x, bestTop, width});
+    for (size_t i = best + 1; i < skyline.size();)
+    {
+        uint32_t end = skyline[i - 1].x + skyline[i - 1].width;
+        if (skyline[i].x >= end)
+        {
+            break;
+        }
+        uint32_t shrink = end - skyline[i].x;
+        if (skyline[i].width <= shrink)
+        {
+            skyline.erase(skyline.begin() + i);
+            continue;
+        }
+        skyline[i].x += shrink;
+        skyline[i].width -= shrink;
+        break;
+    }
+    for (size_t i = 0; i + 1 < skyline.size();)
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+    return true;
+}
+
+// cleared to transparent black so that unused space is defined
+void TextureAtlas::addPage()
+{
+    Texture page;
+    createImage(pageSize, pageSize, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, page.textureImage, page.textureImageMemory, logicalDevice, physicalDevice);
+
+    VkCommandPool commandPool = commandPools->current();
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(logicalDevice, commandPool);
+    recordLayoutTransition(commandBuffer, page.textureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, 1);
+    VkClearColorValue clear{};
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = 1;
+    vkCmdClearColorImage(commandBuffer, page.textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear, 1, &range);
+    recordLayoutTransition(commandBuffer, page.textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, 1);
+    endSingleTimeCommands(commandBuffer, queues, logicalDevice, commandPool);
+
+    page.imageView = createTextureImageView(page, logicalDevice);
+    if (bindless != nullptr)
+    {
+        page.bindlessIndex = bindless->add(page.imageView);
+    }
+    pages.push_back(page);
+    skylines.push_back(std::vector<SkylineNode>{SkylineNode{0, 0, pageSize}});
+}
+
+void TextureAtlas::upload(uint32_t page, const std::vector<stbi_uc> &pixels, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    VkDeviceSize size = pixels.size();
+    auto stagingBuffer = createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+    void *data;
+    vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, size, 0, &data);
+    memcpy(data, pixels.data(), static_cast<size_t>(size));
+    vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
+
+    auto region = mipCopyRegion(0, 0, width, height);
+    region.imageOffset = {static_cast<int32_t>(x), static_cast<int32_t>(y), 0};
+    VkCommandPool commandPool = commandPools->current();
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(logicalDevice, commandPool);
+    recordLayoutTransition(commandBuffer, pages[page].textureImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, 1);
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.buffer, pages[page].textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    recordLayoutTransition(commandBuffer, pages[page].textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, 1);
+    endSingleTimeCommands(commandBuffer, queues, logicalDevice, commandPool);
+
+    vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
+    vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
+}
+
+// textures/<name>.png
+AtlasRegion TextureAtlas::add(std::string name)
+{
+    int texWidth, texHeight, texChannels;
+    std::string path = "textures/" + name + ".png";
+    stbi_uc *pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        throw std::runtime_error("failed to load texture image!");
+    }
+    try
+    {
+        auto region = add(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+        stbi_image_free(pixels);
+        return region;
+    }
+    catch (...)
+    {
+        stbi_image_free(pixels);
+        throw;
+    }
+}
+
+// pixels are RGBA8, a new page is started when no existing one has room
+AtlasRegion TextureAtlas::add(const stbi_uc *pixels, uint32_t width, uint32_t height)
+{
+    uint32_t paddedWidth = width + 2 * padding;
+    uint32_t paddedHeight = height + 2 * padding;
+    if (paddedWidth > pageSize || paddedHeight > pageSize)
+    {
+        throw std::runtime_error("image does not fit into an atlas page!");
+    }
+
+    // the padding repeats the edge texels, so bilinear samples at the border never reach a neighbor
+    std::vector<stbi_uc> padded(paddedWidth * paddedHeight * 4);
+    for (uint32_t row = 0; row < paddedHeight; row++)
+    {
+        uint32_t sourceRow = std::min(std::max(row, padding) - padding, height - 1);
+        for (uint32_t column = 0; column < paddedWidth; column++)
+        {
+            uint32_t sourceColumn = std::min(std::max(column, padding) - padding, width - 1);
+            memcpy(&padded[(row * paddedWidth + column) * 4], &pixels[(sourceRow * width + sourceColumn) * 4], 4);
+        }
+    }
+
+    // packing and the upload share the pages with other threads, and the layout transitions of a page must not interleave
+    std::lock_guard<std::mutex> lock(*mutex);
+    uint32_t page = 0, x, y;
+    while (page < pages.size() && !pack(skylines[page], paddedWidth, paddedHeight, x, y))
+    {
+        page++;
+    }
+    if (page == pages.size())
+    {
+        addPage();
+        pack(skylines[page], paddedWidth, paddedHeight, x, y);
+    }
+
+    upload(page, padded, x, y, paddedWidth, paddedHeight);
+
+    AtlasRegion region;
+    region.page = page;
+    region.textureIndex = pages[page].bindlessIndex;
+    region.uvMin = glm::vec2(x + padding, y + padding) / static_cast<float>(pageSize);
+    region.uvMax = glm::vec2(x + padding + width, y + padding + height) / static_cast<float>(pageSize);
+    return region;
+}
+
+void TextureAtlas::destroy()
+{
+    std::lock_guard<std::mutex> lock(*mutex);
+    for (auto &page : pages)
+    {
+        if (page.bindlessIndex != NO_TEXTURE)
+        {
+            bindless->remove(page.bindlessIndex);
+        }
+        vkDestroyImageView(logicalDevice, page.imageView, nullptr);
+        vkDestroyImage(logicalDevice, page.textureImage, nullptr);
+        vkFreeMemory(logicalDevice, page.textureImageMemory, nullptr);
+    }
+    pages.clear();
+    skylines.clear();
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef texture_atlas_h
+#define texture_atlas_h
+
+#include "common.cpp"
+#include "bindless.h"
+#include "commandPools.h"
+
+// packs small RGBA images into shared pages with a skyline packer, images can be added at any time and from any thread
+class TextureAtlas
+{
+public:
+    uint32_t pageSize;
+    // border around every image, filled with its clamped edge texels against filtering seams
+    uint32_t padding;
+    std::vector<Texture> pages;
+
+    void init(uint32_t pageSize, uint32_t padding, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, CommandPools *commandPools, VkQueues queues, BindlessTextures *bindless);
+    AtlasRegion add(std::string name);
+    AtlasRegion add(const stbi_uc *pixels, uint32_t width, uint32_t height);
+    void destroy();
+
+private:
+    struct SkylineNode
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    VkDevice logicalDevice;
+    VkPhysicalDevice physicalDevice;
+    CommandPools *commandPools;
+    VkQueues queues;
+    BindlessTextures *bindless;
+    // one skyline per page, the top edge of the packed area from left to right
+    std::vector<std::vector<SkylineNode>> skylines;
+    // add may be called from worker threads like the rest of resource creation, held by pointer so atlases can still be returned by value
+    std::unique_ptr<std::mutex> mutex = std::make_unique<std::mutex>();
+
+    bool fit(const std::vector<SkylineNode> &skyline, size_t index, uint32_t width, uint32_t height, uint32_t &y);
+    bool pack(std::vector<SkylineNode> &skyline, uint32_t width, uint32_t height, uint32_t &x, uint32_t &y);
+    void addPage();
+    void upload(uint32_t page, const std::vector<stbi_uc> &pixels, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include "common.cpp"
+#include "textureStreamer.h"
+#include "commands.h"
+#include "vkMemory.h"
+#include "image.h"
+
+void TextureStreamer::start(JobSystem *jobs, int framesInFlight, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueues queues, BindlessTextures *bindless)
+{
+    this->logicalDevice = logicalDevice;
+    this->physicalDevice = physicalDevice;
+    this->queues = queues;
+    this->bindless = bindless;
+    this->jobs = jobs;
+    createPlaceholder(commandPool);
+
+    auto commandBuffers = createCommandBuffers(framesInFlight, commandPool, logicalDevice);
+    frames.resize(framesInFlight);
+    for (int i = 0; i < framesInFlight; i++)
+    {
+        frames[i].commandBuffer = commandBuffers[i];
+        frames[i].staging = createBuffer(uploadBudget, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+        vkMapMemory(logicalDevice, frames[i].staging.bufferMemory, 0, uploadBudget, 0, &frames[i].staging.memMap);
+    }
+}
+
+// a single mid grey texel
+void TextureStreamer::createPlaceholder(VkCommandPool commandPool)
+{
+    stbi_uc texel[] = {128, 128, 128, 255};
+    auto stagingBuffer = createBuffer(sizeof(texel), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+    void *data;
+    vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, sizeof(texel), 0, &data);
+    memcpy(data, texel, sizeof(texel));
+    vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
+
+    createImage(1, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, placeholder.textureImage, placeholder.textureImageMemory, logicalDevice, physicalDevice);
+    transitionImageLayout(placeholder.textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, logicalDevice, commandPool, queues);
+    copyBufferToImage(stagingBuffer.buffer, placeholder.textureImage, std::vector<VkBufferImageCopy>{mipCopyRegion(0, 0, 1, 1)}, logicalDevice, commandPool, queues);
+    transitionImageLayout(placeholder.textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, logicalDevice, commandPool, queues);
+    vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
+    vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
+
+    placeholder.imageView = createTextureImageView(placeholder, logicalDevice);
+    placeholderIndex = bindless->add(placeholder.imageView);
+}
+
+// textures/<name>.png, the returned handle's textureIndex() is valid right away
+uint32_t TextureStreamer::request(std::string name)
+{
+    uint32_t handle = nextHandle++;
+    Streamed texture;
+    texture.textureIndex = placeholderIndex;
+    textures[handle] = texture;
+    jobs->run([this, handle, name]
+              { decode(handle, name); },
+              &decoding);
+    return handle;
+}
+
+// changes while levels stream in, so look it up every frame
+uint32_t TextureStreamer::textureIndex(uint32_t handle)
+{
+    return textures.at(handle).textureIndex;
+}
+
+// true once every mip level is uploaded
+bool TextureStreamer::isResident(uint32_t handle)
+{
+    auto &texture = textures.at(handle);
+    return !texture.levels.empty() && texture.residentLevel == 0;
+}
+
+void TextureStreamer::release(uint32_t handle)
+{
+    auto it = textures.find(handle);
+    if (it == textures.end())
+    {
+        return;
+    }
+    Retired retired;
+    retired.image = it->second.texture.textureImage;
+    retired.memory = it->second.texture.textureImageMemory;
+    if (it->second.textureIndex != placeholderIndex)
+    {
+        retired.view = it->second.texture.imageView;
+        retired.textureIndex = it->second.textureIndex;
+    }
+    // frames in flight may still use it
+    released.push_back(retired);
+    textures.erase(it);
+}
+
+void TextureStreamer::destroyRetired(const Retired &retired)
+{
+    if (retired.textureIndex != NO_TEXTURE)
+    {
+        bindless->remove(retired.textureIndex);
+        vkDestroyImageView(logicalDevice, retired.view, nullptr);
+    }
+    if (retired.image != VK_NULL_HANDLE)
+    {
+        vkDestroyImage(logicalDevice, retired.image, nullptr);
+        vkFreeMemory(logicalDevice, retired.memory, nullptr);
+    }
+}
+
+void TextureStreamer::decode(uint32_t handle, std::string name)
+{
+    Decoded result;
+    result.handle = handle;
+    int texWidth, texHeight, texChannels;
+    std::string path = "textures/" + name + ".png";
+    stbi_uc *pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (pixels)
+    {
+        result.width = static_cast<uint32_t>(texWidth);
+        result.height = static_cast<uint32_t>(texHeight);
+        result.levels.emplace_back(pixels, pixels + result.width * result.height * 4);
+        stbi_image_free(pixels);
+        uint32_t mipWidth = result.width, mipHeight = result.height;
+        for (uint32_t i = 1; i < mipLevelCount(result.width, result.height); i++)
+        {
+            result.levels.push_back(downsample(result.levels.back(), mipWidth, mipHeight));
+            mipWidth = std::max(mipWidth / 2, 1u);
+            mipHeight = std::max(mipHeight / 2, 1u);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    decoded.push_back(std::move(result));
+}
+
+// call once per frame after the frame's fence signaled and before its command buffer is submitted,
+// the uploads go to the same queue ahead of the frame
+void TextureStreamer::update(uint32_t frame)
+{
+    auto &uploads = frames[frame];
+    for (auto &retired : uploads.retired)
+    {
+        destroyRetired(retired);
+    }
+    uploads.retired.clear();
+    for (auto &buffer : uploads.oversized)
+    {
+        vkDestroyBuffer(logicalDevice, buffer.buffer, nullptr);
+        vkFreeMemory(logicalDevice, buffer.bufferMemory, nullptr);
+    }
+    uploads.oversized.clear();
+    uploads.retired.swap(released);
+
+    std::vector<Decoded> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.swap(decoded);
+    }
+    for (auto &result : finished)
+    {
+        auto it = textures.find(result.handle);
+        if (it == textures.end() || result.levels.empty())
+        {
+            continue;
+        }
+        auto &texture = it->second;
+        texture.width = result.width;
+        texture.height = result.height;
+        texture.levels = std::move(result.levels);
+        texture.texture.mipLevels = static_cast<uint32_t>(texture.levels.size());
+        texture.residentLevel = texture.texture.mipLevels;
+        createImage(texture.width, texture.height, texture.texture.mipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.texture.textureImage, texture.texture.textureImageMemory, logicalDevice, physicalDevice);
+    }
+
+    // smallest pending level first, so every texture gets its coarse levels before any gets its fine ones
+    struct Upload
+    {
+        Streamed *texture;
+        uint32_t level;
+        VkBufferImageCopy region;
+    };
+    std::vector<Upload> batch;
+    std::unordered_map<Streamed *, uint32_t> nextLevels;
+    for (auto &entry : textures)
+    {
+        if (entry.second.residentLevel != 0)
+        {
+            nextLevels[&entry.second] = entry.second.residentLevel;
+        }
+    }
+    VkDeviceSize used = 0;
+    Buffer oversized{};
+    while (true)
+    {
+        Streamed *next = nullptr;
+        VkDeviceSize nextSize = 0;
+        for (auto &entry : nextLevels)
+        {
+            if (entry.second == 0)
+            {
+                continue;
+            }
+            VkDeviceSize size = entry.first->levels[entry.second - 1].size();
+            if (next == nullptr || size < nextSize)
+            {
+                next = entry.first;
+                nextSize = size;
+            }
+        }
+        if (next == nullptr)
+        {
+            break;
+        }
+        // 16 byte aligned offsets satisfy the texel size of every format
+        VkDeviceSize offset = (used + 15) & ~VkDeviceSize(15);
+        if (offset + nextSize > uploadBudget)
+        {
+            if (!batch.empty())
+            {
+                break;
+            }
+            oversized = createBuffer(nextSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+            vkMapMemory(logicalDevice, oversized.bufferMemory, 0, nextSize, 0, &oversized.memMap);
+            offset = 0;
+        }
+        uint32_t level = --nextLevels[next];
+        void *staging = oversized.buffer != VK_NULL_HANDLE ? oversized.memMap : uploads.staging.memMap;
+        memcpy((char *)staging + offset, next->levels[level].data(), nextSize);
+        batch.push_back(Upload{next, level, mipCopyRegion(offset, level, std::max(next->width >> level, 1u), std::max(next->height >> level, 1u))});
+        used = offset + nextSize;
+        if (oversized.buffer != VK_NULL_HANDLE)
+        {
+            break;
+        }
+    }
+    if (batch.empty())
+    {
+        return;
+    }
+
+    // one barrier before and one after all copies of the batch
+    std::vector<VkImageMemoryBarrier> toTransfer, toShader;
+    for (auto &upload : batch)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = upload.texture->texture.textureImage;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = upload.level;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        toTransfer.push_back(barrier);
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        toShader.push_back(barrier);
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkResetCommandBuffer(uploads.commandBuffer, 0);
+    vkBeginCommandBuffer(uploads.commandBuffer, &beginInfo);
+    vkCmdPipelineBarrier(uploads.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(toTransfer.size()), toTransfer.data());
+    VkBuffer source = oversized.buffer != VK_NULL_HANDLE ? oversized.buffer : uploads.staging.buffer;
+    for (auto &upload : batch)
+    {
+        vkCmdCopyBufferToImage(uploads.commandBuffer, source, upload.texture->texture.textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &upload.region);
+    }
+    vkCmdPipelineBarrier(uploads.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(toShader.size()), toShader.data());
+    if (vkEndCommandBuffer(uploads.commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record texture upload command buffer!");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &uploads.commandBuffer;
+    if (queueSubmit(queues, queues.graphicsQueue, submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit texture uploads!");
+    }
+    if (oversized.buffer != VK_NULL_HANDLE)
+    {
+        uploads.oversized.push_back(oversized);
+    }
+
+    // the frame being built still samples the old view, it is retired with this frame
+    for (auto &entry : nextLevels)
+    {
+        auto &texture = *entry.first;
+        if (entry.second == texture.residentLevel)
+        {
+            continue;
+        }
+        if (texture.textureIndex != placeholderIndex)
+        {
+            Retired retired;
+            retired.view = texture.texture.imageView;
+            retired.textureIndex = texture.textureIndex;
+            uploads.retired.push_back(retired);
+        }
+        texture.residentLevel = entry.second;
+        texture.texture.imageView = createImageView(texture.texture.textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, texture.residentLevel, texture.texture.mipLevels - texture.residentLevel, logicalDevice);
+        texture.textureIndex = bindless->add(texture.texture.imageView);
+        if (texture.residentLevel == 0)
+        {
+            // the CPU copies are no longer needed
+            texture.levels = std::vector<std::vector<stbi_uc>>(texture.levels.size());
+        }
+    }
+}
+
+// the device has to be idle
+void TextureStreamer::destroy()
+{
+    // the decodes write into this streamer, let them finish
+    jobs->wait(decoding);
+
+    while (!textures.empty())
+    {
+        release(textures.begin()->first);
+    }
+    for (auto &uploads : frames)
+    {
+        released.insert(released.end(), uploads.retired.begin(), uploads.retired.end());
+        for (auto &buffer : uploads.oversized)
+        {
+            vkDestroyBuffer(logicalDevice, buffer.buffer, nullptr);
+            vkFreeMemory(logicalDevice, buffer.bufferMemory, nullptr);
+        }
+        vkDestroyBuffer(logicalDevice, uploads.staging.buffer, nullptr);
+        vkFreeMemory(logicalDevice, uploads.staging.bufferMemory, nullptr);
+    }
+    for (auto &retired : released)
+    {
+        destroyRetired(retired);
+    }
+    released.clear();
+    frames.clear();
+    bindless->remove(placeholderIndex);
+    vkDestroyImageView(logicalDevice, placeholder.imageView, nullptr);
+    vkDestroyImage(logicalDevice, placeholder.textureImage, nullptr);
+    vkFreeMemory(logicalDevice, placeholder.textureImageMemory, nullptr);
+}
\ No newline at end of file
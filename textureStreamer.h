@@ -0,0 +1,86 @@
+#ifndef texture_streamer_h
+#define texture_streamer_h
+
+#include "common.cpp"
+#include "bindless.h"
+#include "jobSystem.h"
+
+// decodes textures as jobs and uploads their mip levels from the smallest to the largest within
+// a per-frame byte budget; a texture's bindless index shows the placeholder until its first levels are resident
+class TextureStreamer
+{
+public:
+    // bytes copied per frame, a single level larger than this is uploaded alone
+    VkDeviceSize uploadBudget = 8 * 1024 * 1024;
+
+    void start(JobSystem *jobs, int framesInFlight, VkDevice logicalDevice, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueues queues, BindlessTextures *bindless);
+    uint32_t request(std::string name);
+    uint32_t textureIndex(uint32_t handle);
+    bool isResident(uint32_t handle);
+    void update(uint32_t frame);
+    void release(uint32_t handle);
+    void destroy();
+
+private:
+    struct Decoded
+    {
+        uint32_t handle;
+        uint32_t width;
+        uint32_t height;
+        // empty if decoding failed, the texture then keeps the placeholder
+        std::vector<std::vector<stbi_uc>> levels;
+    };
+
+    struct Streamed
+    {
+        Texture texture{};
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<std::vector<stbi_uc>> levels;
+        // levels [residentLevel, mipLevels) are uploaded, mipLevels while none are
+        uint32_t residentLevel = 0;
+        uint32_t textureIndex;
+    };
+
+    // freed once the frame that retired it has finished
+    struct Retired
+    {
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t textureIndex = NO_TEXTURE;
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+
+    struct FrameUploads
+    {
+        VkCommandBuffer commandBuffer;
+        Buffer staging;
+        std::vector<Buffer> oversized;
+        std::vector<Retired> retired;
+    };
+
+    VkDevice logicalDevice;
+    VkPhysicalDevice physicalDevice;
+    VkQueues queues;
+    BindlessTextures *bindless;
+    Texture placeholder;
+    uint32_t placeholderIndex;
+    std::vector<FrameUploads> frames;
+    // released since the last update, retired with the next frame
+    std::vector<Retired> released;
+    // only touched by the thread calling update
+    std::unordered_map<uint32_t, Streamed> textures;
+    uint32_t nextHandle = 0;
+
+    JobSystem *jobs;
+    // decodes still running
+    JobCounter decoding;
+    std::vector<Decoded> decoded;
+    std::mutex mutex;
+
+    void decode(uint32_t handle, std::string name);
+    void createPlaceholder(VkCommandPool commandPool);
+    void destroyRetired(const Retired &retired);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "../common.cpp"
+#include "../image.h"
+#include "../compressedTexture.h"
+
+#include <lz4hc.h>
+
+// packAssets <output> [--lz4] <type>:<name>:<path>[:<stride>]...
+// type is texture (png, ktx2 or dds), vertices (raw blob, stride in bytes), indices (raw uint16_t blob) or shader (SPIR-V)
+
+struct Payload
+{
+    PackEntry entry{};
+    std::vector<uint8_t> data;
+};
+
+static std::vector<uint8_t> readFile(std::string path)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open " + path);
+    }
+    std::vector<uint8_t> buffer(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
+    return buffer;
+}
+
+static void appendLevel(Payload &payload, const uint8_t *data, size_t size)
+{
+    if (payload.entry.mipLevels == PACK_MAX_LEVELS)
+    {
+        throw std::runtime_error("too many mip levels!");
+    }
+    payload.data.resize((payload.data.size() + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT);
+    payload.entry.levelOffsets[payload.entry.mipLevels++] = payload.data.size();
+    payload.data.insert(payload.data.end(), data, data + size);
+}
+
+// pngs get their mip chain generated here, compressed containers keep the levels they ship with
+static Payload packTexture(std::string path)
+{
+    Payload payload;
+    payload.entry.type = PACK_TEXTURE;
+    auto extension = path.substr(path.find_last_of('.') + 1);
+    if (extension == "png")
+    {
+        int texWidth, texHeight, texChannels;
+        stbi_uc *pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        if (!pixels)
+        {
+            throw std::runtime_error("failed to load texture image " + path);
+        }
+        payload.entry.format = VK_FORMAT_R8G8B8A8_SRGB;
+        payload.entry.width = static_cast<uint32_t>(texWidth);
+        payload.entry.height = static_cast<uint32_t>(texHeight);
+        std::vector<stbi_uc> level(pixels, pixels + texWidth * texHeight * 4);
+        stbi_image_free(pixels);
+        uint32_t width = payload.entry.width, height = payload.entry.height;
+        uint32_t mipLevels = std::min(mipLevelCount(width, height), PACK_MAX_LEVELS);
+        for (uint32_t i = 0; i < mipLevels; i++)
+        {
+            appendLevel(payload, level.data(), level.size());
+            if (i + 1 < mipLevels)
+            {
+                level = downsample(level, width, height);
+                width = std::max(width / 2, 1u);
+                height = std::max(height / 2, 1u);
+            }
+        }
+        return payload;
+    }
+
+    auto image = loadCompressedImage(path);
+    payload.entry.format = image.format;
+    payload.entry.width = image.width;
+    payload.entry.height = image.height;
+    for (size_t i = 0; i < image.levelOffsets.size(); i++)
+    {
+        size_t end = i + 1 < image.levelOffsets.size() ? image.levelOffsets[i + 1] : image.data.size();
+        appendLevel(payload, image.data.data() + image.levelOffsets[i], end - image.levelOffsets[i]);
+    }
+    return payload;
+}
+
+static Payload packEntry(std::string description)
+{
+    std::vector<std::string> parts;
+    size_t start = 0, end;
+    while ((end = description.find(':', start)) != std::string::npos)
+    {
+        parts.push_back(description.substr(start, end - start));
+        start = end + 1;
+    }
+    parts.push_back(description.substr(start));
+    if (parts.size() < 3 || parts[1].size() >= sizeof(PackEntry::name))
+    {
+        throw std::runtime_error("invalid entry " + description);
+    }
+
+    Payload payload;
+    if (parts[0] == "texture")
+    {
+        payload = packTexture(parts[2]);
+    }
+    else
+    {
+        payload.data = readFile(parts[2]);
+        if (parts[0] == "vertices" && parts.size() == 4)
+        {
+            payload.entry.type = PACK_VERTICES;
+            payload.entry.elementSize = static_cast<uint32_t>(std::stoul(parts[3]));
+        }
+        else if (parts[0] == "indices")
+        {
+            payload.entry.type = PACK_INDICES;
+            payload.entry.elementSize = sizeof(uint16_t);
+        }
+        else if (parts[0] == "shader")
+        {
+            payload.entry.type = PACK_SHADER;
+            payload.entry.elementSize = sizeof(uint32_t);
+        }
+        else
+        {
+            throw std::runtime_error("invalid entry " + description);
+        }
+    }
+    strncpy(payload.entry.name, parts[1].c_str(), sizeof(payload.entry.name) - 1);
+    payload.entry.rawSize = payload.data.size();
+    return payload;
+}
+
+// entries are only stored compressed when that makes them smaller
+static void compress(Payload &payload)
+{
+    std::vector<uint8_t> compressed(LZ4_compressBound(static_cast<int>(payload.data.size())));
+    int size = LZ4_compress_HC(reinterpret_cast<const char *>(payload.data.data()), reinterpret_cast<char *>(compressed.data()), static_cast<int>(payload.data.size()), static_cast<int>(compressed.size()), LZ4HC_CLEVEL_MAX);
+    if (size > 0 && static_cast<size_t>(size) < payload.data.size())
+    {
+        compressed.resize(size);
+        payload.data = std::move(compressed);
+        payload.entry.compression = PACK_LZ4;
+    }
+}
+
+static void pad(std::ofstream &file)
+{
+    static const char zeros[PACK_ALIGNMENT] = {};
+    auto position = static_cast<uint64_t>(file.tellp());
+    file.write(zeros, (PACK_ALIGNMENT - position % PACK_ALIGNMENT) % PACK_ALIGNMENT);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        printf("usage: %s <output> [--lz4] <type>:<name>:<path>[:<stride>]...\n", argv[0]);
+        return 1;
+    }
+    try
+    {
+        bool lz4 = false;
+        std::vector<PackEntry> index;
+        std::ofstream file(argv[1], std::ios::binary | std::ios::trunc);
+        PackHeader header{PACK_MAGIC, PACK_VERSION, 0, 0, 0};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (int i = 2; i < argc; i++)
+        {
+            if (strcmp(argv[i], "--lz4") == 0)
+            {
+                lz4 = true;
+                continue;
+            }
+            auto payload = packEntry(argv[i]);
+            if (lz4)
+            {
+                compress(payload);
+            }
+            pad(file);
+            payload.entry.offset = static_cast<uint64_t>(file.tellp());
+            payload.entry.size = payload.data.size();
+            file.write(reinterpret_cast<const char *>(payload.data.data()), payload.data.size());
+            index.push_back(payload.entry);
+            printf("%s: %llu bytes, %llu stored\n", payload.entry.name, (unsigned long long)payload.entry.rawSize, (unsigned long long)payload.entry.size);
+        }
+        pad(file);
+        header.entryCount = static_cast<uint32_t>(index.size());
+        header.indexOffset = static_cast<uint64_t>(file.tellp());
+        file.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(PackEntry));
+        file.seekp(0);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (!file)
+        {
+            throw std::runtime_error("failed to write " + std::string(argv[1]));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
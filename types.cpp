@@ -6,6 +6,8 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentableFamily;
+    // a compute only family if there is one, so standalone compute runs next to rendering
+    std::optional<uint32_t> computeFamily;
 
     bool isComplete()
     {
@@ -24,6 +26,9 @@ struct VkQueues
 {
     VkQueue graphicsQueue;
     VkQueue presentationQueue;
+    VkQueue computeQueue;
+    // queues are externally synchronized, every submission and present takes this lock (see queueSubmit), copies share it
+    std::mutex *submitMutex = nullptr;
 };
 
 struct SwapChain
@@ -34,6 +39,11 @@ struct SwapChain
     std::vector<VkImage> images;
     std::vector<VkImageView> imageViews;
     std::vector<VkFramebuffer> framebuffers;
+    // VK_FORMAT_UNDEFINED when rendering without a depth buffer
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    VkImage depthImage;
+    VkDeviceMemory depthImageMemory;
+    VkImageView depthImageView;
 };
 
 struct UniformBufferObject
@@ -49,13 +59,105 @@ struct Buffer
     VkDeviceMemory bufferMemory;
     void *memMap;
     int amountElements;
+    // only used by index buffers
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
 };
 
+// see Vesuv::createMesh, indices are 16 bit whenever the vertex count allows it
+struct Mesh
+{
+    Buffer vertexBuffer{};
+    // full detail
+    Buffer indexBuffer{};
+    // coarser levels into the same vertex buffer, each with about half the triangles of the one before
+    std::vector<Buffer> lodIndexBuffers;
+    // per coarser level, its largest distance from the full detail surface in model space, see simplifyMesh
+    std::vector<float> lodErrors;
+    // model space bounding sphere, LODs are picked by its size on screen
+    glm::vec3 center{};
+    float radius = 0.0f;
+};
+
+const uint32_t NO_TEXTURE = UINT32_MAX;
+const uint32_t NO_QUERY = UINT32_MAX;
+
 struct Texture
 {
     VkImage textureImage;
     VkDeviceMemory textureImageMemory;
     VkImageView imageView;
+    VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+    uint32_t mipLevels = 1;
+    uint32_t bindlessIndex = NO_TEXTURE;
+};
+
+// placement of one image in a TextureAtlas page
+struct AtlasRegion
+{
+    uint32_t page;
+    // bindless index of the page, NO_TEXTURE without bindless textures
+    uint32_t textureIndex = NO_TEXTURE;
+    glm::vec2 uvMin;
+    glm::vec2 uvMax;
+
+    // maps a texCoord of the whole image into the page
+    glm::vec2 map(glm::vec2 texCoord) const
+    {
+        return uvMin + texCoord * (uvMax - uvMin);
+    }
+};
+
+// block compressed (or R8) pixel data as stored in a KTX2 or DDS file, levels packed largest first
+struct CompressedImage
+{
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> data;
+    std::vector<VkDeviceSize> levelOffsets;
+};
+
+// asset pack layout: PackHeader, payloads aligned to PACK_ALIGNMENT, then entryCount PackEntries at indexOffset
+const uint32_t PACK_MAGIC = 0x4B415056; // "VPAK"
+const uint32_t PACK_VERSION = 1;
+const uint32_t PACK_ALIGNMENT = 16;
+const uint32_t PACK_MAX_LEVELS = 16;
+
+const uint32_t PACK_TEXTURE = 0;
+const uint32_t PACK_VERTICES = 1;
+const uint32_t PACK_INDICES = 2;
+const uint32_t PACK_SHADER = 3;
+
+const uint32_t PACK_UNCOMPRESSED = 0;
+const uint32_t PACK_LZ4 = 1;
+
+struct PackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t indexOffset;
+};
+
+struct PackEntry
+{
+    char name[64];
+    uint32_t type;
+    uint32_t compression;
+    // stored payload in the file and its size once decompressed
+    uint64_t offset;
+    uint64_t size;
+    uint64_t rawSize;
+    // textures: VkFormat, extent and level offsets into the decompressed payload, levels largest first
+    // vertices: elementSize is the vertex stride, indices: 2 for uint16_t, 4 for uint32_t
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    uint32_t elementSize;
+    uint32_t reserved;
+    uint64_t levelOffsets[PACK_MAX_LEVELS];
 };
 
 struct SyncObjects
@@ -82,6 +184,247 @@ struct GraphicsPipeline
     std::vector<Uniforms> uniforms;
 };
 
+struct ComputePipeline
+{
+    VkPipeline pipeline;
+    VkPipelineLayout layout;
+    VkShaderModule shader;
+};
+
+// one vkCmdDispatch, the listed resources are made visible to draws and later dispatches
+struct ComputeDispatch
+{
+    VkPipeline pipeline;
+    VkPipelineLayout layout;
+    VkDescriptorSet descriptorSet;
+    uint32_t groupCountX = 1;
+    uint32_t groupCountY = 1;
+    uint32_t groupCountZ = 1;
+    std::vector<uint8_t> pushConstants;
+    // zeroed right before the dispatch, e.g. atomic counters
+    std::vector<Buffer> bufferClears;
+    std::vector<Buffer> bufferWrites;
+    // storage images stay in VK_IMAGE_LAYOUT_GENERAL
+    std::vector<VkImage> imageWrites;
+};
+
+inline void hashCombine(size_t &seed, size_t value)
+{
+    seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+// generated from a vertex struct by VertexLayout in vertex.h
+struct VertexInput
+{
+    VkVertexInputBindingDescription binding{};
+    std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+// everything a graphics pipeline is built from, viewport and scissor are dynamic and not part of it
+struct PipelineDescription
+{
+    std::string shaderName;
+    VkDescriptorSetLayout descriptorLayout;
+    // set 1, the bindless texture table
+    VkDescriptorSetLayout textureLayout = VK_NULL_HANDLE;
+    std::vector<VkPushConstantRange> pushConstants;
+    VkRenderPass renderPass;
+    VkVertexInputBindingDescription vertexBinding;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    bool blendEnable = false;
+    bool depthTest = false;
+    bool depthWrite = false;
+    VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    bool operator==(const PipelineDescription &other) const
+    {
+        if (vertexAttributes.size() != other.vertexAttributes.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < vertexAttributes.size(); i++)
+        {
+            auto &a = vertexAttributes[i];
+            auto &b = other.vertexAttributes[i];
+            if (a.location != b.location || a.binding != b.binding || a.format != b.format || a.offset != b.offset)
+            {
+                return false;
+            }
+        }
+        if (pushConstants.size() != other.pushConstants.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < pushConstants.size(); i++)
+        {
+            auto &a = pushConstants[i];
+            auto &b = other.pushConstants[i];
+            if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+            {
+                return false;
+            }
+        }
+        return shaderName == other.shaderName &&
+               descriptorLayout == other.descriptorLayout &&
+               textureLayout == other.textureLayout &&
+               renderPass == other.renderPass &&
+               vertexBinding.binding == other.vertexBinding.binding &&
+               vertexBinding.stride == other.vertexBinding.stride &&
+               vertexBinding.inputRate == other.vertexBinding.inputRate &&
+               topology == other.topology &&
+               polygonMode == other.polygonMode &&
+               cullMode == other.cullMode &&
+               frontFace == other.frontFace &&
+               blendEnable == other.blendEnable &&
+               depthTest == other.depthTest &&
+               depthWrite == other.depthWrite &&
+               colorWriteMask == other.colorWriteMask;
+    }
+};
+
+struct PipelineDescriptionHash
+{
+    size_t operator()(const PipelineDescription &description) const
+    {
+        size_t seed = std::hash<std::string>{}(description.shaderName);
+        hashCombine(seed, std::hash<const void *>{}(description.descriptorLayout));
+        hashCombine(seed, std::hash<const void *>{}(description.textureLayout));
+        for (auto &range : description.pushConstants)
+        {
+            hashCombine(seed, range.stageFlags);
+            hashCombine(seed, range.offset);
+            hashCombine(seed, range.size);
+        }
+        hashCombine(seed, std::hash<const void *>{}(description.renderPass));
+        hashCombine(seed, description.vertexBinding.binding);
+        hashCombine(seed, description.vertexBinding.stride);
+        hashCombine(seed, description.vertexBinding.inputRate);
+        for (auto &attribute : description.vertexAttributes)
+        {
+            hashCombine(seed, attribute.location);
+            hashCombine(seed, attribute.binding);
+            hashCombine(seed, attribute.format);
+            hashCombine(seed, attribute.offset);
+        }
+        hashCombine(seed, description.topology);
+        hashCombine(seed, description.polygonMode);
+        hashCombine(seed, description.cullMode);
+        hashCombine(seed, description.frontFace);
+        hashCombine(seed, description.blendEnable);
+        hashCombine(seed, description.depthTest);
+        hashCombine(seed, description.depthWrite);
+        hashCombine(seed, description.colorWriteMask);
+        return seed;
+    }
+};
+
+// result of an asynchronous pipeline compilation, check isReady() before drawing with it
+struct PipelineHandle
+{
+    std::shared_future<GraphicsPipeline> pipeline;
+    std::vector<Uniforms> uniforms;
+    // finds the cache entry again in destroyPipeline, even when the compilation failed
+    PipelineDescription description;
+
+    bool isReady()
+    {
+        return pipeline.valid() && pipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+};
+
+// see Vesuv::pipelines, every create or compile call holds one reference until its destroyPipeline
+struct CachedPipeline
+{
+    std::shared_future<GraphicsPipeline> pipeline;
+    int refCount;
+};
+
+// one draw as recorded into the frame's command buffer
+struct DrawCommand
+{
+    VkPipeline pipeline;
+    VkPipelineLayout layout;
+    Buffer vertexBuffer;
+    Buffer indexBuffer;
+    VkDescriptorSet descriptorSet;
+    // index into the bindless texture table, pushed as a push constant
+    uint32_t textureIndex = NO_TEXTURE;
+    // view space distance, opaque draws are sorted front to back, transparent ones back to front
+    float depth = 0.0f;
+    bool opaque = true;
+    // GPU generated draws (see Vesuv::cullDraw): up to maxDrawCount VkDrawIndexedIndirectCommands,
+    // the actual amount is read from countBuffer if it is set
+    Buffer indirectBuffer{};
+    Buffer countBuffer{};
+    uint32_t maxDrawCount = 0;
+    // false records one vkCmdDrawIndexedIndirect per command, for devices without multiDrawIndirect
+    bool multiDrawIndirect = true;
+    // occlusion culling: the object's id, its bounding proxy is drawn inside a query before it
+    // (see Vesuv::createOcclusionProxyPipeline), occluded is set from the results of an earlier frame
+    uint32_t occlusionQuery = NO_QUERY;
+    VkPipeline proxyPipeline = VK_NULL_HANDLE;
+    Buffer proxyVertexBuffer{};
+    bool occluded = false;
+    // index count of the mesh's full detail level if indexBuffer is a coarser one, see Vesuv::selectLod
+    uint32_t fullDetailIndices = 0;
+    // a range of a shared index buffer, 0 draws all of it; vertexOffset is added to every index
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+    // the object's SceneTransforms handle, shaders like shader/scene.vert read its world matrix with gl_InstanceIndex
+    uint32_t firstInstance = 0;
+};
+
+// bounding sphere and index range of one object, std430 layout of shader/cull.comp
+struct CullObject
+{
+    // xyz center, w radius, in the space the uniform buffer's model matrix transforms from
+    glm::vec4 sphere;
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    // passed as firstInstance, so vertex shaders find per-object data with gl_InstanceIndex
+    uint32_t objectIndex;
+};
+
+// GPU frustum culling input and output for objects sharing one pipeline, vertex and index buffer
+struct CullingBatch
+{
+    Buffer objects;
+    Buffer indirectCommands;
+    Buffer drawCount;
+    uint32_t amountObjects;
+    // one per frame in flight, each reading that frame's uniform buffer
+    std::vector<VkDescriptorSet> descriptorSets;
+};
+
+// records the commands of one render graph pass, the render pass is already begun, textureSet is the bindless
+// texture set (VK_NULL_HANDLE without bindless) to hand on to recordDraws
+typedef std::function<void(VkCommandBuffer commandBuffer, VkExtent2D extent, const std::vector<DrawCommand> &draws, VkDescriptorSet textureSet)> RecordPass;
+
+// render graph attachment handles, attachments created by the graph start at 1
+const uint32_t SWAPCHAIN_ATTACHMENT = 0;
+const uint32_t NO_ATTACHMENT = UINT32_MAX;
+
+struct VesuvSettings
+{
+    // textures go into one descriptor indexing table instead of per-object descriptor sets
+    bool bindless = false;
+    // adds a depth attachment to the render pass, pipelines then test and write depth
+    bool depthBuffer = false;
+    // counts fragment shader invocations per frame, see Vesuv::fragmentInvocations
+    bool pipelineStatistics = false;
+    // amount of objects that can be occlusion culled (ids 0 to occlusionQueries - 1), needs the depth buffer
+    uint32_t occlusionQueries = 0;
+    // job system threads besides the main thread, -1 for one less than the hardware threads but at least one
+    int workerThreads = -1;
+    // keeps every job system thread on its own cpu
+    bool pinWorkerThreads = false;
+};
+
 struct Window
 {
     GLFWwindow *window;
@@ -3,44 +3,256 @@
 
 #include "common.cpp"
 
-#include "common.cpp"
+// round to nearest even, values beyond the half range become infinity
+inline uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = ((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
 
-struct Vertex
+    if (((bits >> 23) & 0xff) == 0xff)
+    {
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+    if (exponent >= 31)
+    {
+        return sign | 0x7c00;
+    }
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return sign;
+        }
+        // subnormal, shift the implicit one in
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1)))
+        {
+            half++;
+        }
+        return sign | half;
+    }
+    uint32_t half = (exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    // a carry out of the mantissa correctly bumps the exponent
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return sign | half;
+}
+
+inline uint8_t floatToUnorm8(float value)
 {
-    glm::vec2 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+inline uint16_t floatToUnorm16(float value)
+{
+    return static_cast<uint16_t>(std::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+// packed attribute types, the vertex fetch unpacks them so shaders keep reading floats
+struct Half2
+{
+    uint16_t x = 0;
+    uint16_t y = 0;
+
+    Half2() = default;
+    Half2(float x, float y) : x(floatToHalf(x)), y(floatToHalf(y)) {}
+    Half2(glm::vec2 v) : Half2(v.x, v.y) {}
+};
 
-    static VkVertexInputBindingDescription getBindingDescription()
+struct Half4
+{
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint16_t z = 0;
+    uint16_t w = 0;
+
+    Half4() = default;
+    Half4(float x, float y, float z, float w = 1.0f) : x(floatToHalf(x)), y(floatToHalf(y)), z(floatToHalf(z)), w(floatToHalf(w)) {}
+    Half4(glm::vec3 v) : Half4(v.x, v.y, v.z) {}
+};
+
+// a vec3 shader input reads the first three components
+struct Unorm8x4
+{
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint8_t a = 255;
+
+    Unorm8x4() = default;
+    Unorm8x4(float r, float g, float b, float a = 1.0f) : r(floatToUnorm8(r)), g(floatToUnorm8(g)), b(floatToUnorm8(b)), a(floatToUnorm8(a)) {}
+    Unorm8x4(glm::vec3 v) : Unorm8x4(v.x, v.y, v.z) {}
+};
+
+// only covers [0, 1], repeating texture coordinates need Half2
+struct Unorm16x2
+{
+    uint16_t u = 0;
+    uint16_t v = 0;
+
+    Unorm16x2() = default;
+    Unorm16x2(float u, float v) : u(floatToUnorm16(u)), v(floatToUnorm16(v)) {}
+    Unorm16x2(glm::vec2 v) : Unorm16x2(v.x, v.y) {}
+};
+
+template <typename T>
+struct VertexFormat;
+
+template <>
+struct VertexFormat<float>
+{
+    static constexpr VkFormat format = VK_FORMAT_R32_SFLOAT;
+};
+
+template <>
+struct VertexFormat<glm::vec2>
+{
+    static constexpr VkFormat format = VK_FORMAT_R32G32_SFLOAT;
+};
+
+template <>
+struct VertexFormat<glm::vec3>
+{
+    static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+};
+
+template <>
+struct VertexFormat<glm::vec4>
+{
+    static constexpr VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
+};
+
+template <>
+struct VertexFormat<Half2>
+{
+    static constexpr VkFormat format = VK_FORMAT_R16G16_SFLOAT;
+};
+
+template <>
+struct VertexFormat<Half4>
+{
+    static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
+};
+
+template <>
+struct VertexFormat<Unorm8x4>
+{
+    static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+};
+
+template <>
+struct VertexFormat<Unorm16x2>
+{
+    static constexpr VkFormat format = VK_FORMAT_R16G16_UNORM;
+};
+
+template <typename V, typename T>
+uint32_t memberOffset(T V::*member)
+{
+    static const V vertex{};
+    return static_cast<uint32_t>(reinterpret_cast<const char *>(&(vertex.*member)) - reinterpret_cast<const char *>(&vertex));
+}
+
+template <typename T>
+struct MemberType;
+
+template <typename V, typename T>
+struct MemberType<T V::*>
+{
+    using type = T;
+};
+
+// the members become locations 0, 1, ... in the order they are listed, their formats follow from their types
+template <typename V, auto... Members>
+struct VertexLayout
+{
+    static constexpr uint32_t amountAttributes = sizeof...(Members);
+    static constexpr std::array<VkFormat, sizeof...(Members)> formats = {VertexFormat<typename MemberType<decltype(Members)>::type>::format...};
+
+    static VkVertexInputBindingDescription binding()
     {
         VkVertexInputBindingDescription bindingDescription{};
         bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
+        bindingDescription.stride = sizeof(V);
         bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
         return bindingDescription;
     }
 
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions()
+    static std::array<VkVertexInputAttributeDescription, sizeof...(Members)> attributes()
+    {
+        std::array<uint32_t, sizeof...(Members)> offsets = {memberOffset(Members)...};
+        std::array<VkVertexInputAttributeDescription, sizeof...(Members)> attributeDescriptions{};
+        for (uint32_t i = 0; i < amountAttributes; i++)
+        {
+            attributeDescriptions[i].binding = 0;
+            attributeDescriptions[i].location = i;
+            attributeDescriptions[i].format = formats[i];
+            attributeDescriptions[i].offset = offsets[i];
+        }
+        return attributeDescriptions;
+    }
+
+    static VertexInput input()
     {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+        auto attributeDescriptions = attributes();
+        VertexInput vertexInput;
+        vertexInput.binding = binding();
+        vertexInput.attributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+        return vertexInput;
+    }
+};
 
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
+// 28 bytes, full precision
+struct Vertex
+{
+    glm::vec2 pos;
+    glm::vec3 color;
+    glm::vec2 texCoord;
 
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
+    using Layout = VertexLayout<Vertex, &Vertex::pos, &Vertex::color, &Vertex::texCoord>;
+};
 
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+// 12 bytes, same shader inputs as Vertex
+struct SpriteVertex
+{
+    Half2 pos;
+    Unorm8x4 color;
+    Unorm16x2 texCoord;
 
-        return attributeDescriptions;
-    }
+    using Layout = VertexLayout<SpriteVertex, &SpriteVertex::pos, &SpriteVertex::color, &SpriteVertex::texCoord>;
 };
+static_assert(sizeof(SpriteVertex) == 12, "SpriteVertex must stay tightly packed");
+
+// 16 bytes, written by SpriteBatch; full float positions since sprites are placed at sub-pixel precision,
+// the locations match SpriteVertex so the same shaders read both
+struct BatchVertex
+{
+    glm::vec2 pos;
+    Unorm16x2 texCoord;
+    Unorm8x4 color;
+
+    using Layout = VertexLayout<BatchVertex, &BatchVertex::pos, &BatchVertex::color, &BatchVertex::texCoord>;
+};
+static_assert(sizeof(BatchVertex) == 16, "BatchVertex must stay tightly packed");
+
+// 32 bytes, written by the mesh loader in mesh.cpp, read by shader/mesh.vert
+struct MeshVertex
+{
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec2 texCoord;
+
+    using Layout = VertexLayout<MeshVertex, &MeshVertex::pos, &MeshVertex::normal, &MeshVertex::texCoord>;
+};
+
 #endif
\ No newline at end of file
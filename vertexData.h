@@ -4,7 +4,7 @@
 #include "common.cpp"
 #include "vertex.h"
 
-const std::vector<Vertex> quadVertices = {
+const std::vector<SpriteVertex> quadVertices = {
     // tri
     {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},  // oben rechts
     {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}}, // oben links
@@ -15,7 +15,7 @@ const std::vector<Vertex> quadVertices = {
 const std::vector<uint16_t>
     quadIndices = {0, 1, 2, 2, 1, 3};
 
-const std::vector<Vertex> triVertices = {
+const std::vector<SpriteVertex> triVertices = {
     // pos,col?,tex
     {{0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},  // oben rechts
     {{-0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}}, // oben links
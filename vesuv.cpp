@@ -9,8 +9,10 @@
 #include "image.h"
 #include "vkMemory.h"
 #include "vertex.h"
+#include "compressedTexture.h"
+#include "mesh.h"
 
-Vesuv::Vesuv()
+Vesuv::Vesuv(VesuvSettings settings)
     : physicalDevice{},
       logicalDevice{},
       instance{},
@@ -18,10 +20,47 @@ Vesuv::Vesuv()
       window{},
       queueIndices{},
       queues{},
+      queueMutex{},
       renderPass{},
       syncObjects{},
       commandPool{},
-      descriptorPool{},
+      uploadPools{},
+      computePools{},
+      descriptorAllocator{},
+      frameDescriptorAllocators{},
+      frameDescriptorsInFlight{},
+      descriptorMutex{},
+      renderThread{std::this_thread::get_id()},
+      pipelineCache{},
+      shaderRegistry{},
+      layoutCache{},
+      pipelineCompiler{},
+      jobSystem{},
+      bindless{false},
+      bindlessTextures{},
+      bindlessSampler{},
+      resourceCache{},
+      textureStreamer{},
+      renderGraph{},
+      statisticsQueries{},
+      frameStatisticsWritten{},
+      fragmentInvocations{0},
+      sortDraws{true},
+      occlusionQueries{},
+      frameOcclusionWritten{},
+      objectsOccluded{},
+      occludedObjects{0},
+      lodBaseSize{400.0f},
+      lodHysteresis{0.1f},
+      lodMaxError{2.0f},
+      objectLods{},
+      submittedTriangles{0},
+      fullDetailTriangles{0},
+      drawIndirectCount{false},
+      multiDrawIndirect{false},
+      drawIndirectFirstInstance{false},
+      cullPipeline{},
+      cullLayout{},
       MAX_FRAMES_IN_FLIGHT{2},
       currentFrame{0},
       framebufferResized{false}
@@ -32,30 +71,127 @@ Vesuv::Vesuv()
     this->instance = createInstance(validationLayers);
     this->window.surface = createSurface(this->window.window, this->instance);
     this->physicalDevice = pickPhysicalDevice(this->instance, this->window.surface);
-    this->logicalDevice = createLogicalDevice(this->physicalDevice, this->window.surface);
+    this->bindless = settings.bindless && checkBindlessSupport(this->physicalDevice);
+    bool pipelineStatistics = settings.pipelineStatistics && checkPipelineStatisticsSupport(this->physicalDevice);
+    this->drawIndirectCount = checkDrawIndirectCountSupport(this->physicalDevice);
+    this->multiDrawIndirect = checkMultiDrawIndirectSupport(this->physicalDevice);
+    this->drawIndirectFirstInstance = checkDrawIndirectFirstInstanceSupport(this->physicalDevice);
+    this->logicalDevice = createLogicalDevice(this->physicalDevice, this->window.surface, this->bindless, pipelineStatistics, this->drawIndirectCount);
     this->queueIndices = findQueueFamilies(this->physicalDevice, this->window.surface);
     this->queues = getQueues(this->logicalDevice, this->queueIndices);
+    this->queues.submitMutex = &queueMutex;
     this->swapChain = createSwapChain(physicalDevice, logicalDevice, this->window.surface, this->window.window);
+    if (settings.depthBuffer)
+    {
+        this->swapChain.depthFormat = findDepthFormat(physicalDevice);
+        createDepthResources(swapChain, physicalDevice, logicalDevice);
+    }
     this->renderPass = createRenderPass(swapChain, logicalDevice);
     createFramebuffers(swapChain, renderPass, logicalDevice);
     this->commandPool = createCommandPool(queueIndices, logicalDevice);
-    this->descriptorPool = createDescriptorPool(MAX_FRAMES_IN_FLIGHT, logicalDevice);
+    this->uploadPools.init(logicalDevice, queueIndices.graphicsFamily.value());
+    this->computePools.init(logicalDevice, queueIndices.computeFamily.value());
+    this->descriptorAllocator.init(logicalDevice, 64, &layoutCache);
+    this->frameDescriptorAllocators.resize(MAX_FRAMES_IN_FLIGHT);
+    for (auto &allocator : frameDescriptorAllocators)
+    {
+        allocator.init(logicalDevice, 256, &layoutCache);
+    }
+    this->frameDescriptorsInFlight.resize(MAX_FRAMES_IN_FLIGHT, false);
+    if (pipelineStatistics)
+    {
+        this->statisticsQueries = createStatisticsQueryPool(MAX_FRAMES_IN_FLIGHT, logicalDevice);
+    }
+    this->frameStatisticsWritten.resize(MAX_FRAMES_IN_FLIGHT, false);
+    // without depth every proxy passes, the queries would only cost time
+    if (settings.occlusionQueries != 0 && settings.depthBuffer)
+    {
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            this->occlusionQueries.push_back(createOcclusionQueryPool(settings.occlusionQueries, logicalDevice));
+        }
+        this->objectsOccluded.resize(settings.occlusionQueries, false);
+    }
+    this->frameOcclusionWritten.resize(MAX_FRAMES_IN_FLIGHT, false);
+    this->renderGraph.init(logicalDevice, physicalDevice);
     this->syncObjects = createSyncObjects(MAX_FRAMES_IN_FLIGHT, logicalDevice);
     this->commandBuffers = createCommandBuffers(MAX_FRAMES_IN_FLIGHT, commandPool, logicalDevice);
+    this->pipelineCache = createPipelineCache(logicalDevice);
+    this->shaderRegistry.init(logicalDevice);
+    this->layoutCache.init(logicalDevice);
+    // the thread constructing Vesuv is the job system's thread 0, the render thread
+    int workerThreads = settings.workerThreads >= 0 ? settings.workerThreads : std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    this->jobSystem.start(workerThreads, settings.pinWorkerThreads);
+    this->pipelineCompiler.start(&jobSystem, logicalDevice, pipelineCache, &shaderRegistry, &layoutCache);
+    this->resourceCache.init(logicalDevice, physicalDevice, &uploadPools, queues, bindless ? &bindlessTextures : nullptr);
+    if (bindless)
+    {
+        this->bindlessSampler = resourceCache.acquireSampler();
+        this->bindlessTextures.init(logicalDevice, physicalDevice, bindlessSampler, MAX_FRAMES_IN_FLIGHT);
+        this->textureStreamer.start(&jobSystem, MAX_FRAMES_IN_FLIGHT, logicalDevice, physicalDevice, commandPool, queues, &bindlessTextures);
+    }
 };
 
 void Vesuv::cleanup()
 {
-
+    pipelineCompiler.stop();
+    // whatever is still referenced
+    for (auto &cached : pipelines)
+    {
+        try
+        {
+            auto pipeline = cached.second.pipeline.get();
+            vkDestroyPipeline(logicalDevice, pipeline.pipeline, nullptr);
+            shaderRegistry.release(pipeline.fragShader);
+            shaderRegistry.release(pipeline.vertShader);
+        }
+        catch (const std::exception &)
+        {
+            // failed compilations have nothing to destroy
+        }
+    }
+    pipelines.clear();
+    if (cullPipeline.pipeline != VK_NULL_HANDLE)
+    {
+        destroyPipeline(cullPipeline);
+    }
+    vkDestroyPipelineCache(logicalDevice, pipelineCache, nullptr);
+    shaderRegistry.destroy();
+    layoutCache.destroy();
+    if (bindless)
+    {
+        textureStreamer.destroy();
+    }
+    jobSystem.stop();
+    resourceCache.destroy();
+    if (bindless)
+    {
+        bindlessTextures.destroy();
+    }
+    if (statisticsQueries != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(logicalDevice, statisticsQueries, nullptr);
+    }
+    for (auto &pool : occlusionQueries)
+    {
+        vkDestroyQueryPool(logicalDevice, pool, nullptr);
+    }
+    renderGraph.destroy();
     cleanupSwapChain(swapChain, logicalDevice);
     vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
-    vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+    descriptorAllocator.destroy();
+    for (auto &allocator : frameDescriptorAllocators)
+    {
+        allocator.destroy();
+    }
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
         vkDestroySemaphore(logicalDevice, syncObjects.renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(logicalDevice, syncObjects.imageAvailableSemaphores[i], nullptr);
         vkDestroyFence(logicalDevice, syncObjects.inFlightFences[i], nullptr);
     }
+    uploadPools.destroy();
+    computePools.destroy();
     vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
     vkDestroySurfaceKHR(instance, window.surface, nullptr);
     vkDestroyDevice(logicalDevice, nullptr);
@@ -65,36 +201,134 @@ void Vesuv::cleanup()
     glfwTerminate();
 }
 
+// everything depending on the window size is rebuilt here, pipelines are untouched as viewport and scissor are dynamic
+void Vesuv::resize()
+{
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window.window, &width, &height);
+    while (width == 0 || height == 0)
+    {
+        glfwGetFramebufferSize(window.window, &width, &height);
+        glfwWaitEvents();
+    }
+
+    vkDeviceWaitIdle(logicalDevice);
+    cleanupSwapChain(swapChain, logicalDevice);
+
+    auto depthFormat = swapChain.depthFormat;
+    swapChain = createSwapChain(physicalDevice, logicalDevice, window.surface, window.window);
+    swapChain.depthFormat = depthFormat;
+    createDepthResources(swapChain, physicalDevice, logicalDevice);
+    createFramebuffers(swapChain, renderPass, logicalDevice);
+    if (!renderGraph.empty())
+    {
+        renderGraph.resize(swapChain);
+    }
+}
+
 void Vesuv::destroySampler(VkSampler sampler)
 {
-    vkDestroySampler(logicalDevice, sampler, nullptr);
+    if (!resourceCache.releaseSampler(sampler))
+    {
+        vkDestroySampler(logicalDevice, sampler, nullptr);
+    }
 }
 
+// cached textures are only destroyed with their last user
 void Vesuv::destroyTexture(Texture texture)
 {
+    if (resourceCache.releaseTexture(texture))
+    {
+        return;
+    }
+    if (texture.bindlessIndex != NO_TEXTURE)
+    {
+        bindlessTextures.remove(texture.bindlessIndex);
+    }
     vkDestroyImageView(logicalDevice, texture.imageView, nullptr);
     vkDestroyImage(logicalDevice, texture.textureImage, nullptr);
     vkFreeMemory(logicalDevice, texture.textureImageMemory, nullptr);
 }
 
+// drops one reference, the VkPipeline is destroyed with the last one
 void Vesuv::destroyPipeline(GraphicsPipeline pipeline)
+{
+    for (auto it = pipelines.begin(); it != pipelines.end(); it++)
+    {
+        PipelineHandle cached{it->second.pipeline};
+        try
+        {
+            if (!cached.isReady() || cached.pipeline.get().pipeline != pipeline.pipeline)
+            {
+                continue;
+            }
+        }
+        catch (const std::exception &)
+        {
+            // failed compilation, cannot be the pipeline to destroy
+            continue;
+        }
+        if (--it->second.refCount > 0)
+        {
+            return;
+        }
+        pipelines.erase(it);
+        vkDestroyPipeline(logicalDevice, pipeline.pipeline, nullptr);
+        shaderRegistry.release(pipeline.fragShader);
+        shaderRegistry.release(pipeline.vertShader);
+        return;
+    }
+}
+
+// waits for a compilation that is still running, a failed one only gives up its reference
+void Vesuv::destroyPipeline(PipelineHandle pipeline)
+{
+    auto cached = pipelines.find(pipeline.description);
+    if (!pipeline.pipeline.valid() || cached == pipelines.end())
+    {
+        return;
+    }
+    if (--cached->second.refCount > 0)
+    {
+        return;
+    }
+    auto compiling = cached->second.pipeline;
+    pipelines.erase(cached);
+    try
+    {
+        auto compiled = compiling.get();
+        vkDestroyPipeline(logicalDevice, compiled.pipeline, nullptr);
+        shaderRegistry.release(compiled.fragShader);
+        shaderRegistry.release(compiled.vertShader);
+    }
+    catch (const std::exception &)
+    {
+        // failed compilations have nothing to destroy
+    }
+}
+
+void Vesuv::destroyPipeline(ComputePipeline pipeline)
 {
     vkDestroyPipeline(logicalDevice, pipeline.pipeline, nullptr);
-    vkDestroyPipelineLayout(logicalDevice, pipeline.layout, nullptr);
-    vkDestroyShaderModule(logicalDevice, pipeline.fragShader, nullptr);
-    vkDestroyShaderModule(logicalDevice, pipeline.vertShader, nullptr);
+    shaderRegistry.release(pipeline.shader);
 }
 
 void Vesuv::destroyUniforms(Uniforms uniforms)
 {
-    vkDestroyDescriptorSetLayout(logicalDevice, uniforms.descriptorSetLayout, nullptr);
-    for (size_t i = 0; i < uniforms.amountSetElements; i++)
+    for (size_t i = 0; i < uniforms.uniformBuffers.size(); i++)
     {
         vkDestroyBuffer(logicalDevice, uniforms.uniformBuffers[i].buffer, nullptr);
         vkFreeMemory(logicalDevice, uniforms.uniformBuffers[i].bufferMemory, nullptr);
     }
 }
 
+void Vesuv::destroyCullingBatch(CullingBatch batch)
+{
+    destroyBuffer(batch.objects);
+    destroyBuffer(batch.indirectCommands);
+    destroyBuffer(batch.drawCount);
+}
+
 void Vesuv::destroyBuffer(Buffer buffer)
 {
     vkDestroyBuffer(logicalDevice, buffer.buffer, nullptr);
@@ -103,22 +337,391 @@ void Vesuv::destroyBuffer(Buffer buffer)
 
 VkDescriptorSetLayout Vesuv::createUniformLayouts(std::vector<VkDescriptorType> types, int amountInVertexShader)
 {
-    return createDescriptorSetLayout(logicalDevice, types, amountInVertexShader);
+    return createDescriptorSetLayout(layoutCache, types, amountInVertexShader);
 }
 
-GraphicsPipeline Vesuv::createGraphicPipeline(VkDescriptorSetLayout layout, std::string shaderName)
+PipelineDescription Vesuv::describePipeline(VkDescriptorSetLayout layout, std::string shaderName, VertexInput vertexInput)
 {
-    return createGraphicsPipeline(shaderName, logicalDevice, swapChain, layout, renderPass);
+    auto description = createPipelineDescription(shaderName, layout, renderPass, vertexInput);
+    if (bindless)
+    {
+        description.textureLayout = bindlessTextures.layout;
+        description.pushConstants.push_back(VkPushConstantRange{VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t)});
+    }
+    if (swapChain.depthFormat != VK_FORMAT_UNDEFINED)
+    {
+        description.depthTest = true;
+        description.depthWrite = true;
+    }
+    return description;
 }
 
-Texture Vesuv::createTexture(std::string name)
+GraphicsPipeline Vesuv::createGraphicPipeline(VkDescriptorSetLayout layout, std::string shaderName, VertexInput vertexInput)
+{
+    return createGraphicPipeline(describePipeline(layout, shaderName, vertexInput));
+}
+
+// identical descriptions share one VkPipeline, every call needs its own destroyPipeline
+GraphicsPipeline Vesuv::createGraphicPipeline(PipelineDescription description)
+{
+    auto cached = pipelines.find(description);
+    if (cached != pipelines.end())
+    {
+        auto pipeline = cached->second.pipeline.get();
+        cached->second.refCount++;
+        return pipeline;
+    }
+    std::promise<GraphicsPipeline> pipeline;
+    pipeline.set_value(createGraphicsPipeline(description, logicalDevice, pipelineCache, shaderRegistry, layoutCache));
+    auto &entry = pipelines[description] = CachedPipeline{pipeline.get_future().share(), 1};
+    return entry.pipeline.get();
+}
+
+PipelineHandle Vesuv::compileGraphicPipeline(VkDescriptorSetLayout layout, std::string shaderName, VertexInput vertexInput)
+{
+    return compileGraphicPipeline(describePipeline(layout, shaderName, vertexInput));
+}
+
+PipelineHandle Vesuv::compileGraphicPipeline(PipelineDescription description)
+{
+    PipelineHandle handle;
+    handle.description = description;
+    auto cached = pipelines.find(description);
+    if (cached != pipelines.end())
+    {
+        cached->second.refCount++;
+        handle.pipeline = cached->second.pipeline;
+        return handle;
+    }
+    handle.pipeline = pipelineCompiler.submit(description);
+    pipelines[description] = CachedPipeline{handle.pipeline, 1};
+    return handle;
+}
+
+VkDescriptorSetLayout Vesuv::createComputeLayout(std::vector<VkDescriptorType> types)
+{
+    return createComputeDescriptorSetLayout(layoutCache, types);
+}
+
+// loads shader/<shaderName>_cs.spv
+ComputePipeline Vesuv::createComputePipeline(VkDescriptorSetLayout layout, std::string shaderName, uint32_t pushConstantSize)
+{
+    return ::createComputePipeline(shaderName, layout, pushConstantSize, logicalDevice, pipelineCache, shaderRegistry, layoutCache);
+}
+
+VkDescriptorSet Vesuv::allocateDescriptorSet(VkDescriptorSetLayout layout)
+{
+    std::lock_guard<std::mutex> lock(descriptorMutex);
+    return descriptorAllocator.allocate(layout);
+}
+
+// device local, shared by the graphics and compute queue, usage is added to the storage usage (e.g. vertex buffer)
+Buffer Vesuv::createStorageBuffer(VkDeviceSize size, VkBufferUsageFlags usage)
+{
+    auto buffer = createBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, logicalDevice, physicalDevice, std::vector<uint32_t>{queueIndices.graphicsFamily.value(), queueIndices.computeFamily.value()});
+    buffer.amountElements = 0;
+    return buffer;
+}
+
+// in GENERAL layout, shared by the graphics and compute queue like createStorageBuffer's buffers
+Texture Vesuv::createStorageImage(uint32_t width, uint32_t height, VkFormat format)
 {
     Texture texture;
-    texture = createTextureImage(logicalDevice, physicalDevice, commandPool, queues, name);
+    createImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.textureImage, texture.textureImageMemory, logicalDevice, physicalDevice, std::vector<uint32_t>{queueIndices.graphicsFamily.value(), queueIndices.computeFamily.value()});
+    transitionImageLayout(texture.textureImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, logicalDevice, uploadPools.current(), queues);
+    texture.imageView = createImageView(texture.textureImage, format, logicalDevice);
+    return texture;
+}
+
+// runs inside the next frame, before its draws
+void Vesuv::dispatch(ComputeDispatch dispatch)
+{
+    frameDispatches.push_back(dispatch);
+}
+
+// runs on the compute queue and blocks until the results are ready, callable from any thread
+void Vesuv::runCompute(const std::vector<ComputeDispatch> &dispatches)
+{
+    VkCommandPool computeCommandPool = computePools.current();
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(logicalDevice, computeCommandPool);
+    recordDispatches(commandBuffer, dispatches, false);
+    vkEndCommandBuffer(commandBuffer);
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create fence!");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    if (queueSubmit(queues, queues.computeQueue, submitInfo, fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit compute command buffer!");
+    }
+    vkWaitForFences(logicalDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+    vkDestroyFence(logicalDevice, fence, nullptr);
+    vkFreeCommandBuffers(logicalDevice, computeCommandPool, 1, &commandBuffer);
+}
+
+// uniformBuffers are the per-frame buffers of the objects' Uniforms, their view and projection define the frustum;
+// the generated draws pass each object's index as firstInstance, which needs drawIndirectFirstInstance
+CullingBatch Vesuv::createCullingBatch(std::vector<CullObject> objects, std::vector<Buffer> uniformBuffers)
+{
+    if (!drawIndirectFirstInstance)
+    {
+        throw std::runtime_error("GPU culling needs the drawIndirectFirstInstance feature!");
+    }
+    if (cullPipeline.pipeline == VK_NULL_HANDLE)
+    {
+        cullLayout = createComputeLayout(std::vector<VkDescriptorType>{
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        });
+        cullPipeline = createComputePipeline(cullLayout, "cull", 2 * sizeof(uint32_t));
+    }
+
+    CullingBatch batch;
+    batch.amountObjects = objects.size();
+    VkDeviceSize bufferSize = sizeof(objects[0]) * objects.size();
+    batch.objects = createStorageBuffer(bufferSize, 0);
+    batch.indirectCommands = createStorageBuffer(sizeof(VkDrawIndexedIndirectCommand) * objects.size(), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    batch.drawCount = createStorageBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+    auto stagingBuffer = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+    void *data;
+    vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, objects.data(), (size_t)bufferSize);
+    vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
+    copyBuffer(stagingBuffer.buffer, batch.objects.buffer, bufferSize, logicalDevice, uploadPools.current(), queues);
+    vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
+    vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
+
+    VkDescriptorBufferInfo uniformInfo{};
+    uniformInfo.offset = 0;
+    uniformInfo.range = sizeof(UniformBufferObject);
+    VkWriteDescriptorSet uniformWrite{};
+    uniformWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    uniformWrite.dstBinding = 0;
+    uniformWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uniformWrite.descriptorCount = 1;
+    uniformWrite.pBufferInfo = &uniformInfo;
+    for (auto &uniformBuffer : uniformBuffers)
+    {
+        auto set = allocateDescriptorSet(cullLayout);
+        uniformInfo.buffer = uniformBuffer.buffer;
+        uniformWrite.dstSet = set;
+        vkUpdateDescriptorSets(logicalDevice, 1, &uniformWrite, 0, nullptr);
+        writeStorageBuffer(set, 1, batch.objects, logicalDevice);
+        writeStorageBuffer(set, 2, batch.indirectCommands, logicalDevice);
+        writeStorageBuffer(set, 3, batch.drawCount, logicalDevice);
+        batch.descriptorSets.push_back(set);
+    }
+    return batch;
+}
+
+// queues this frame's culling and returns the indirect draw of the visible objects, the CPU cost does not depend on the amount of objects
+DrawCommand Vesuv::cullDraw(CullingBatch &batch, GraphicsPipeline pipeline, Buffer vertexBuffer, Buffer indexBuffer, VkDescriptorSet descriptorSet)
+{
+    // without vkCmdDrawIndexedIndirectCount every object keeps its slot and culled ones get zero instances,
+    // the same without multiDrawIndirect since then every slot is drawn on its own
+    bool compact = drawIndirectCount && multiDrawIndirect;
+    uint32_t pushConstants[] = {batch.amountObjects, compact ? 1u : 0u};
+
+    ComputeDispatch culling;
+    culling.pipeline = cullPipeline.pipeline;
+    culling.layout = cullPipeline.layout;
+    culling.descriptorSet = batch.descriptorSets[currentFrame];
+    culling.groupCountX = (batch.amountObjects + 63) / 64;
+    culling.pushConstants = std::vector<uint8_t>((uint8_t *)pushConstants, (uint8_t *)pushConstants + sizeof(pushConstants));
+    culling.bufferClears = std::vector<Buffer>{batch.drawCount};
+    culling.bufferWrites = std::vector<Buffer>{batch.indirectCommands, batch.drawCount};
+    dispatch(culling);
+
+    DrawCommand draw;
+    draw.pipeline = pipeline.pipeline;
+    draw.layout = pipeline.layout;
+    draw.vertexBuffer = vertexBuffer;
+    draw.indexBuffer = indexBuffer;
+    draw.descriptorSet = descriptorSet;
+    draw.indirectBuffer = batch.indirectCommands;
+    if (compact)
+    {
+        draw.countBuffer = batch.drawCount;
+    }
+    draw.maxDrawCount = batch.amountObjects;
+    draw.multiDrawIndirect = multiDrawIndirect;
+    return draw;
+}
+
+// shader/proxy.vert draws the bounding geometry with the object's uniforms, depth is tested but nothing is written
+GraphicsPipeline Vesuv::createOcclusionProxyPipeline(VkDescriptorSetLayout layout)
+{
+    auto description = describePipeline(layout, "proxy");
+    description.colorWriteMask = 0;
+    description.depthWrite = false;
+    description.cullMode = VK_CULL_MODE_NONE;
+    return createGraphicPipeline(description);
+}
+
+// textures/<name>.png, loaded once and shared by every caller until each of them destroyed it
+Texture Vesuv::createTexture(std::string name)
+{
+    return resourceCache.acquireTexture(name);
+}
+
+// not cached, destroyTexture destroys it right away
+Texture Vesuv::createTexture(AssetPack &pack, std::string name)
+{
+    Texture texture = pack.loadTexture(name);
+    if (bindless)
+    {
+        texture.bindlessIndex = bindlessTextures.add(texture.imageView);
+    }
+    return texture;
+}
+
+AssetPack Vesuv::openAssetPack(std::string path)
+{
+    AssetPack pack;
+    pack.open(path, logicalDevice, physicalDevice, &uploadPools, queues);
+    return pack;
+}
+
+VkSampler Vesuv::createSampler()
+{
+    return resourceCache.acquireSampler();
+}
+
+VkSampler Vesuv::createSampler(const VkSamplerCreateInfo &info)
+{
+    return resourceCache.acquireSampler(info);
+}
+
+// fileName is a .ktx2 or .dds file in textures/, block compressed formats are transcoded if the device can't sample them
+Texture Vesuv::createCompressedTexture(std::string fileName)
+{
+    Texture texture = ::createCompressedTexture(logicalDevice, physicalDevice, uploadPools.current(), queues, fileName);
     texture.imageView = createTextureImageView(texture, logicalDevice);
+    if (bindless)
+    {
+        texture.bindlessIndex = bindlessTextures.add(texture.imageView);
+    }
     return texture;
 }
 
+// returns a TextureStreamer handle, draw with textureStreamer.textureIndex(handle) which shows a placeholder until the texture is uploaded
+uint32_t Vesuv::streamTexture(std::string name)
+{
+    if (!bindless)
+    {
+        throw std::runtime_error("texture streaming needs bindless textures!");
+    }
+    return textureStreamer.request(name);
+}
+
+// pages are added to the bindless table when it is enabled, destroy the atlas before cleanup()
+TextureAtlas Vesuv::createTextureAtlas(uint32_t pageSize, uint32_t padding)
+{
+    TextureAtlas atlas;
+    atlas.init(pageSize, padding, logicalDevice, physicalDevice, &uploadPools, queues, bindless ? &bindlessTextures : nullptr);
+    return atlas;
+}
+
+SpriteBatch Vesuv::createSpriteBatch()
+{
+    SpriteBatch batch;
+    batch.init(MAX_FRAMES_IN_FLIGHT, logicalDevice, physicalDevice, uploadPools.current(), queues);
+    return batch;
+}
+
+// shader/sprite.vert passes the batch's clip space positions through, sprites are alpha blended in draw order
+GraphicsPipeline Vesuv::createSpritePipeline()
+{
+    if (!bindless)
+    {
+        throw std::runtime_error("sprite pipelines need bindless textures!");
+    }
+    auto description = describePipeline(createUniformLayouts({}, 0), "sprite", BatchVertex::Layout::input());
+    description.blendEnable = true;
+    description.cullMode = VK_CULL_MODE_NONE;
+    description.depthTest = false;
+    description.depthWrite = false;
+    return createGraphicPipeline(description);
+}
+
+// waits until the GPU is done with the current frame slot, its sprite vertex memory is then rewritten
+void Vesuv::beginSprites(SpriteBatch &batch, const glm::mat3 &projection)
+{
+    vkWaitForFences(logicalDevice, 1, &syncObjects.inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    batch.begin(currentFrame, projection);
+}
+
+void Vesuv::destroySpriteBatch(SpriteBatch &batch)
+{
+    batch.destroy();
+}
+
+// one storage buffer of capacity world matrices per frame in flight, written by the CPU and read by vertex shaders
+SceneTransforms Vesuv::createSceneTransforms(uint32_t capacity)
+{
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(capacity) * sizeof(glm::mat4);
+    std::vector<Buffer> frameBuffers(MAX_FRAMES_IN_FLIGHT);
+    for (auto &buffer : frameBuffers)
+    {
+        buffer = createBuffer(bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
+        vkMapMemory(logicalDevice, buffer.bufferMemory, 0, bufferSize, 0, &buffer.memMap);
+        buffer.amountElements = static_cast<int>(capacity);
+    }
+    SceneTransforms scene;
+    scene.init(capacity, frameBuffers, &jobSystem);
+    return scene;
+}
+
+// writes into the current frame's buffer, so it waits until the GPU is done with that frame
+void Vesuv::updateSceneTransforms(SceneTransforms &scene)
+{
+    vkWaitForFences(logicalDevice, 1, &syncObjects.inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    scene.update(currentFrame);
+}
+
+// for shader/scene.vert: view and projection in the uniform buffer, the frame's world matrices of the scene at
+// binding 1 and the texture at binding 2; draws pass their node as firstInstance (see drawFrame)
+Uniforms Vesuv::createSceneUniforms(SceneTransforms &scene, Texture texture, VkSampler sampler)
+{
+    Uniforms uniforms;
+    uniforms.amountSetElements = 3;
+    uniforms.descriptorSetLayout = createUniformLayouts(std::vector<VkDescriptorType>{
+                                                            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                        },
+                                                        2);
+    uniforms.uniformBuffers = createUniformBuffers(MAX_FRAMES_IN_FLIGHT);
+    std::lock_guard<std::mutex> lock(descriptorMutex);
+    uniforms.descriptorSets = createDescriptorSets(MAX_FRAMES_IN_FLIGHT, uniforms.descriptorSetLayout, descriptorAllocator, logicalDevice, texture.imageView, uniforms.uniformBuffers, sampler, 2);
+    for (size_t i = 0; i < uniforms.descriptorSets.size(); i++)
+    {
+        writeStorageBuffer(uniforms.descriptorSets[i], 1, scene.frameBuffers[i], logicalDevice);
+    }
+    return uniforms;
+}
+
+void Vesuv::destroySceneTransforms(SceneTransforms &scene)
+{
+    for (auto &buffer : scene.frameBuffers)
+    {
+        destroyBuffer(buffer);
+    }
+    scene.frameBuffers.clear();
+}
+
 std::vector<Buffer> Vesuv::createUniformBuffers(int amount)
 {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
@@ -139,24 +742,43 @@ Uniforms Vesuv::createUniforms(std::vector<VkDescriptorType> types, int amountIn
     uniforms.amountSetElements = types.size();
     uniforms.descriptorSetLayout = createUniformLayouts(types, amountInVertexShader);
     uniforms.uniformBuffers = createUniformBuffers(MAX_FRAMES_IN_FLIGHT);
-    uniforms.descriptorSets = createDescriptorSets(MAX_FRAMES_IN_FLIGHT, uniforms.descriptorSetLayout, descriptorPool, logicalDevice, texture.imageView, uniforms.uniformBuffers, sampler);
+    std::lock_guard<std::mutex> lock(descriptorMutex);
+    uniforms.descriptorSets = createDescriptorSets(MAX_FRAMES_IN_FLIGHT, uniforms.descriptorSetLayout, descriptorAllocator, logicalDevice, texture.imageView, uniforms.uniformBuffers, sampler);
     return uniforms;
 }
 
-Buffer Vesuv::createVBO(std::vector<Vertex> vertices)
+// the set is only valid for the frame currently being built, its pool is reset once that frame's fence signals
+// frame local sets belong to currentFrame, so only the render thread may allocate them; other threads use
+// allocateDescriptorSet
+VkDescriptorSet Vesuv::allocateFrameDescriptorSet(VkDescriptorSetLayout layout)
 {
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+    if (std::this_thread::get_id() != renderThread)
+    {
+        throw std::runtime_error("frame descriptor sets can only be allocated on the render thread!");
+    }
+    if (frameDescriptorsInFlight[currentFrame])
+    {
+        vkWaitForFences(logicalDevice, 1, &syncObjects.inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        frameDescriptorAllocators[currentFrame].reset();
+        frameDescriptorsInFlight[currentFrame] = false;
+    }
+    return frameDescriptorAllocators[currentFrame].allocate(layout);
+}
+
+Buffer Vesuv::createVBO(const void *vertices, VkDeviceSize stride, size_t amountVertices)
+{
+    VkDeviceSize bufferSize = stride * amountVertices;
 
     auto stagingBuffer = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
 
     void *data;
     vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, vertices.data(), (size_t)bufferSize);
+    memcpy(data, vertices, (size_t)bufferSize);
     vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
 
     auto vertexBuffer = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, logicalDevice, physicalDevice);
-    vertexBuffer.amountElements = vertices.size();
-    copyBuffer(stagingBuffer.buffer, vertexBuffer.buffer, bufferSize, logicalDevice, commandPool, queues);
+    vertexBuffer.amountElements = amountVertices;
+    copyBuffer(stagingBuffer.buffer, vertexBuffer.buffer, bufferSize, logicalDevice, uploadPools.current(), queues);
     vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
     vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
     return vertexBuffer;
@@ -164,43 +786,227 @@ Buffer Vesuv::createVBO(std::vector<Vertex> vertices)
 
 Buffer Vesuv::createIndexBuffer(std::vector<uint16_t> indices)
 {
-    VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+    return createIndexBuffer(indices.data(), indices.size(), VK_INDEX_TYPE_UINT16);
+}
+
+Buffer Vesuv::createIndexBuffer(std::vector<uint32_t> indices)
+{
+    return createIndexBuffer(indices.data(), indices.size(), VK_INDEX_TYPE_UINT32);
+}
+
+Buffer Vesuv::createIndexBuffer(const void *indices, size_t amountIndices, VkIndexType indexType)
+{
+    VkDeviceSize bufferSize = (indexType == VK_INDEX_TYPE_UINT32 ? sizeof(uint32_t) : sizeof(uint16_t)) * amountIndices;
 
     auto stagingBuffer = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, logicalDevice, physicalDevice);
 
     void *data;
     vkMapMemory(logicalDevice, stagingBuffer.bufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, indices.data(), (size_t)bufferSize);
+    memcpy(data, indices, (size_t)bufferSize);
     vkUnmapMemory(logicalDevice, stagingBuffer.bufferMemory);
 
     auto indexBuffer = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, logicalDevice, physicalDevice);
-    indexBuffer.amountElements = indices.size();
-    copyBuffer(stagingBuffer.buffer, indexBuffer.buffer, bufferSize, logicalDevice, commandPool, queues);
+    indexBuffer.amountElements = amountIndices;
+    indexBuffer.indexType = indexType;
+    copyBuffer(stagingBuffer.buffer, indexBuffer.buffer, bufferSize, logicalDevice, uploadPools.current(), queues);
 
     vkDestroyBuffer(logicalDevice, stagingBuffer.buffer, nullptr);
     vkFreeMemory(logicalDevice, stagingBuffer.bufferMemory, nullptr);
     return indexBuffer;
 }
 
-void Vesuv::drawFrame(std::vector<Buffer> vertices, std::vector<Buffer> indices, GraphicsPipeline graphicsPipeline)
+// path is a .obj or .glb file, draw it with a pipeline using MeshVertex::Layout, e.g. shader/mesh.vert;
+// amountLods coarser levels are simplified at load time, fewer if the mesh can't be reduced further
+Mesh Vesuv::createMesh(std::string path, uint32_t amountLods)
+{
+    auto data = loadMesh(path);
+    std::vector<float> errors;
+    auto lods = generateLods(data, amountLods, errors);
+    Mesh mesh;
+    boundingSphere(data.vertices, mesh.center, mesh.radius);
+    mesh.vertexBuffer = createVBO(data.vertices);
+    for (size_t i = 0; i < lods.size(); i++)
+    {
+        Buffer indexBuffer;
+        if (data.vertices.size() <= 1u << 16)
+        {
+            std::vector<uint16_t> indices(lods[i].begin(), lods[i].end());
+            indexBuffer = createIndexBuffer(indices);
+        }
+        else
+        {
+            indexBuffer = createIndexBuffer(lods[i]);
+        }
+        if (i == 0)
+        {
+            mesh.indexBuffer = indexBuffer;
+        }
+        else
+        {
+            mesh.lodIndexBuffers.push_back(indexBuffer);
+            mesh.lodErrors.push_back(errors[i]);
+        }
+    }
+    return mesh;
+}
+
+// draws[id] belongs to the index's object id; what is in view keeps the order of draws. drawFrame may still sort them
+// by depth, only transparent draws at equal depth are guaranteed to blend in this order, see sortDrawCommands
+std::vector<DrawCommand> Vesuv::visibleDraws(const SpatialIndex &index, const glm::mat4 &viewProjection, const std::vector<DrawCommand> &draws)
 {
+    std::vector<uint32_t> visible;
+    index.queryFrustum(viewProjection, visible);
+    std::sort(visible.begin(), visible.end());
+    std::vector<DrawCommand> result;
+    result.reserve(visible.size());
+    for (uint32_t object : visible)
+    {
+        if (object < draws.size())
+        {
+            result.push_back(draws[object]);
+        }
+    }
+    return result;
+}
+
+// sets the draw's buffers to the LOD fitting the mesh's size on screen, object is a stable id per drawn object
+uint32_t Vesuv::selectLod(DrawCommand &draw, uint32_t object, const Mesh &mesh, const glm::mat4 &modelView, const glm::mat4 &projection)
+{
+    float size = projectedDiameter(mesh.center, mesh.radius, modelView, projection, static_cast<float>(swapChain.extent.height));
+    uint32_t amountLevels = static_cast<uint32_t>(mesh.lodIndexBuffers.size()) + 1;
+    if (object >= objectLods.size())
+    {
+        objectLods.resize(object + 1, 0);
+    }
+    // the threshold between level l and l + 1 is lodBaseSize / 2^l, the error scales with the mesh's size on screen like
+    // its diameter does. both limits get the same hysteresis band, so neither flips the level back and forth
+    float pixelsPerUnit = mesh.radius > 0.0f ? size / (2.0f * mesh.radius) : 0.0f;
+    uint32_t lod = std::min(objectLods[object], amountLevels - 1);
+    while (lod + 1 < amountLevels && size < lodBaseSize / static_cast<float>(1u << lod) * (1.0f - lodHysteresis) &&
+           mesh.lodErrors[lod] * pixelsPerUnit < lodMaxError * (1.0f - lodHysteresis))
+    {
+        lod++;
+    }
+    while (lod > 0 && (size > lodBaseSize / static_cast<float>(1u << (lod - 1)) * (1.0f + lodHysteresis) ||
+                       mesh.lodErrors[lod - 1] * pixelsPerUnit > lodMaxError * (1.0f + lodHysteresis)))
+    {
+        lod--;
+    }
+    objectLods[object] = lod;
+
+    draw.vertexBuffer = mesh.vertexBuffer;
+    draw.indexBuffer = lod == 0 ? mesh.indexBuffer : mesh.lodIndexBuffers[lod - 1];
+    draw.fullDetailIndices = static_cast<uint32_t>(mesh.indexBuffer.amountElements);
+    return lod;
+}
+
+void Vesuv::destroyMesh(Mesh mesh)
+{
+    for (auto &indexBuffer : mesh.lodIndexBuffers)
+    {
+        destroyBuffer(indexBuffer);
+    }
+    destroyBuffer(mesh.indexBuffer);
+    destroyBuffer(mesh.vertexBuffer);
+}
+
+// nodes are the objects' SceneTransforms handles, if the pipeline reads the scene's world matrices
+void Vesuv::drawFrame(std::vector<Buffer> vertices, std::vector<Buffer> indices, GraphicsPipeline graphicsPipeline, std::vector<uint32_t> nodes)
+{
+    std::vector<DrawCommand> draws(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        draws[i].pipeline = graphicsPipeline.pipeline;
+        draws[i].layout = graphicsPipeline.layout;
+        draws[i].vertexBuffer = vertices[i];
+        draws[i].indexBuffer = indices[i];
+        draws[i].descriptorSet = graphicsPipeline.uniforms[i].amountSetElements != 0 ? graphicsPipeline.uniforms[i].descriptorSets[currentFrame] : VK_NULL_HANDLE;
+        draws[i].firstInstance = nodes.empty() ? 0 : nodes[i];
+    }
+    drawFrame(draws);
+}
+
+void Vesuv::drawFrame(const std::vector<DrawCommand> &draws)
+{
+    // checked before an image is acquired, a failure later would leave the acquire semaphore signaled
+    if (!renderGraph.empty() && !renderGraph.isCompiled())
+    {
+        throw std::runtime_error("render graph has to be compiled before drawing!");
+    }
     vkWaitForFences(logicalDevice, 1, &syncObjects.inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    if (frameDescriptorsInFlight[currentFrame])
+    {
+        frameDescriptorAllocators[currentFrame].reset();
+        frameDescriptorsInFlight[currentFrame] = false;
+    }
+    if (frameStatisticsWritten[currentFrame])
+    {
+        vkGetQueryPoolResults(logicalDevice, statisticsQueries, currentFrame, 1, sizeof(fragmentInvocations), &fragmentInvocations, sizeof(fragmentInvocations), VK_QUERY_RESULT_64_BIT);
+        frameStatisticsWritten[currentFrame] = false;
+    }
+    if (frameOcclusionWritten[currentFrame])
+    {
+        // the fence signaled, so this doesn't stall; queries the frame didn't use stay unavailable and keep the old state
+        std::vector<uint64_t> results(2 * objectsOccluded.size());
+        vkGetQueryPoolResults(logicalDevice, occlusionQueries[currentFrame], 0, objectsOccluded.size(), results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        for (size_t i = 0; i < objectsOccluded.size(); i++)
+        {
+            if (results[2 * i + 1] != 0)
+            {
+                objectsOccluded[i] = results[2 * i] == 0;
+            }
+        }
+        frameOcclusionWritten[currentFrame] = false;
+    }
 
     uint32_t imageIndex;
     auto result = vkAcquireNextImageKHR(logicalDevice, swapChain.swapchain, UINT64_MAX, syncObjects.imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
-        recreateSwapChain(window.window, logicalDevice, window.surface, physicalDevice, swapChain, renderPass);
+        resize();
         return;
     }
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
     {
         throw std::runtime_error("failed to acquire swapchain image");
     }
-    vkResetFences(logicalDevice, 1, &syncObjects.inFlightFences[currentFrame]);
+    if (bindless)
+    {
+        bindlessTextures.recycle(currentFrame);
+        textureStreamer.update(currentFrame);
+    }
 
     vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-    recordCommandBuffer(commandBuffers[currentFrame], imageIndex, graphicsPipeline, swapChain, renderPass, graphicsPipeline.uniforms, currentFrame, vertices, indices);
+    VkDescriptorSet textureSet = bindless ? bindlessTextures.set : VK_NULL_HANDLE;
+    auto sorted = draws;
+    if (sortDraws && swapChain.depthFormat != VK_FORMAT_UNDEFINED)
+    {
+        sortDrawCommands(sorted);
+    }
+    if (renderGraph.empty())
+    {
+        VkQueryPool frameOcclusionQueries = occlusionQueries.empty() ? VK_NULL_HANDLE : occlusionQueries[currentFrame];
+        occludedObjects = 0;
+        if (frameOcclusionQueries != VK_NULL_HANDLE)
+        {
+            for (auto &draw : sorted)
+            {
+                if (draw.occlusionQuery != NO_QUERY)
+                {
+                    draw.occluded = objectsOccluded[draw.occlusionQuery];
+                    occludedObjects += draw.occluded ? 1 : 0;
+                }
+            }
+            frameOcclusionWritten[currentFrame] = true;
+        }
+        recordCommandBuffer(commandBuffers[currentFrame], imageIndex, swapChain, renderPass, sorted, frameDispatches, textureSet, statisticsQueries, currentFrame, frameOcclusionQueries, objectsOccluded.size());
+    }
+    else
+    {
+        recordRenderGraph(commandBuffers[currentFrame], imageIndex, renderGraph, sorted, frameDispatches, textureSet, statisticsQueries, currentFrame);
+    }
+    frameDispatches.clear();
+    countTriangles(sorted, submittedTriangles, fullDetailTriangles);
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -216,10 +1022,14 @@ void Vesuv::drawFrame(std::vector<Buffer> vertices, std::vector<Buffer> indices,
     VkSemaphore signalSemaphores[] = {syncObjects.renderFinishedSemaphores[currentFrame]};
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
-    if (vkQueueSubmit(queues.graphicsQueue, 1, &submitInfo, syncObjects.inFlightFences[currentFrame]) != VK_SUCCESS)
+    // only reset once nothing can throw before the submit, otherwise the fence would never signal again
+    vkResetFences(logicalDevice, 1, &syncObjects.inFlightFences[currentFrame]);
+    if (queueSubmit(queues, queues.graphicsQueue, submitInfo, syncObjects.inFlightFences[currentFrame]) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
+    frameDescriptorsInFlight[currentFrame] = true;
+    frameStatisticsWritten[currentFrame] = statisticsQueries != VK_NULL_HANDLE;
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -230,11 +1040,11 @@ void Vesuv::drawFrame(std::vector<Buffer> vertices, std::vector<Buffer> indices,
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &imageIndex;
-    result = vkQueuePresentKHR(queues.presentationQueue, &presentInfo);
+    result = queuePresent(queues, presentInfo);
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized)
     {
         framebufferResized = false;
-        recreateSwapChain(window.window, logicalDevice, window.surface, physicalDevice, swapChain, renderPass);
+        resize();
     }
     else if (result != VK_SUCCESS)
     {
@@ -242,7 +1052,26 @@ void Vesuv::drawFrame(std::vector<Buffer> vertices, std::vector<Buffer> indices,
     }
 
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+// draws with the compiled pipeline once it is ready, until then with the fallback (using the fallback's uniforms)
+// or, without a fallback, presents an empty frame instead of waiting for the compilation
+void Vesuv::drawFrame(std::vector<Buffer> vertices, std::vector<Buffer> indices, PipelineHandle &pipeline, GraphicsPipeline fallback, std::vector<uint32_t> nodes)
+{
+    if (pipeline.isReady())
+    {
+        auto graphicsPipeline = pipeline.pipeline.get();
+        graphicsPipeline.uniforms = pipeline.uniforms;
+        drawFrame(vertices, indices, graphicsPipeline, nodes);
+    }
+    else if (fallback.pipeline != VK_NULL_HANDLE)
+    {
+        drawFrame(vertices, indices, fallback, nodes);
+    }
+    else
+    {
+        drawFrame(std::vector<DrawCommand>{});
+    }
 }
 
 void Vesuv::listExtensionProperties()
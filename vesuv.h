@@ -3,6 +3,22 @@
 
 #include "common.cpp"
 #include "vertex.h"
+#include "shaderRegistry.h"
+#include "descriptorAllocator.h"
+#include "layoutCache.h"
+#include "pipelineCompiler.h"
+#include "bindless.h"
+#include "renderGraph.h"
+#include "computePipeline.h"
+#include "textureStreamer.h"
+#include "textureAtlas.h"
+#include "resourceCache.h"
+#include "assetPack.h"
+#include "spriteBatch.h"
+#include "jobSystem.h"
+#include "commandPools.h"
+#include "sceneTransforms.h"
+#include "spatialIndex.h"
 
 class Vesuv
 {
@@ -14,30 +30,140 @@ public:
     Window window;
     QueueFamilyIndices queueIndices;
     VkQueues queues;
+    // queues.submitMutex points here
+    std::mutex queueMutex;
     VkRenderPass renderPass;
     SyncObjects syncObjects;
     VkCommandPool commandPool;
-    VkDescriptorPool descriptorPool;
+    // single time commands of resource creation, so any thread can create buffers and textures
+    CommandPools uploadPools;
+    // runCompute's command buffers, so jobs can run compute work too
+    CommandPools computePools;
+    DescriptorAllocator descriptorAllocator;
+    // like currentFrame only used by the render thread, see allocateFrameDescriptorSet
+    std::vector<DescriptorAllocator> frameDescriptorAllocators;
+    std::vector<bool> frameDescriptorsInFlight;
+    // guards descriptorAllocator, which any thread may allocate from
+    std::mutex descriptorMutex;
+    // the thread that created this Vesuv and draws the frames
+    std::thread::id renderThread;
+    VkPipelineCache pipelineCache;
+    ShaderRegistry shaderRegistry;
+    LayoutCache layoutCache;
+    PipelineCompiler pipelineCompiler;
+    // CPU side work: texture decoding, scene transform updates, and whatever the application runs on it
+    JobSystem jobSystem;
+    bool bindless;
+    BindlessTextures bindlessTextures;
+    VkSampler bindlessSampler;
+    // createTexture and createSampler share what was already created
+    ResourceCache resourceCache;
+    // asynchronous texture loading, needs bindless textures
+    TextureStreamer textureStreamer;
+    // when it has passes, frames are rendered through the graph instead of renderPass, it has to be compiled first
+    RenderGraph renderGraph;
+    VkQueryPool statisticsQueries;
+    std::vector<bool> frameStatisticsWritten;
+    // fragment shader invocations of the last completed frame, needs VesuvSettings::pipelineStatistics
+    uint64_t fragmentInvocations = 0;
+    // sort draws front to back before recording, only done with a depth buffer
+    bool sortDraws = true;
+    // one occlusion query pool per frame in flight, read once the frame's fence signaled
+    std::vector<VkQueryPool> occlusionQueries;
+    std::vector<bool> frameOcclusionWritten;
+    // per object id, from the latest results read back
+    std::vector<bool> objectsOccluded;
+    // objects skipped in the last drawFrame, needs VesuvSettings::occlusionQueries
+    uint32_t occludedObjects = 0;
+    // projected diameter in pixels below which meshes switch to their first coarser LOD, every further level at half of it
+    float lodBaseSize = 400.0f;
+    // fraction a mesh's size or LOD error has to pass its limit by before it switches, so it doesn't flicker at the limit
+    float lodHysteresis = 0.1f;
+    // largest simplification error in pixels a coarser LOD may show on screen, finer levels are used above it
+    float lodMaxError = 2.0f;
+    // per object id, the LOD it was drawn with last
+    std::vector<uint32_t> objectLods;
+    // triangles recorded in the last drawFrame, and what they would have been with every mesh at full detail
+    uint64_t submittedTriangles = 0;
+    uint64_t fullDetailTriangles = 0;
+    std::unordered_map<PipelineDescription, CachedPipeline, PipelineDescriptionHash> pipelines;
     std::vector<VkCommandBuffer> commandBuffers;
+    // recorded before the render pass of the next drawFrame
+    std::vector<ComputeDispatch> frameDispatches;
+    bool drawIndirectCount;
+    // without it indirect draws are recorded one command at a time
+    bool multiDrawIndirect;
+    // GPU culling passes the object index as firstInstance and needs it, see createCullingBatch
+    bool drawIndirectFirstInstance;
+    // shader/cull.comp, created with the first culling batch
+    ComputePipeline cullPipeline;
+    VkDescriptorSetLayout cullLayout;
     int MAX_FRAMES_IN_FLIGHT = 2;
     uint32_t currentFrame = 0;
     bool framebufferResized = false;
 
-    Vesuv();
+    Vesuv(VesuvSettings settings = VesuvSettings{});
     void cleanup();
+    void resize();
     VkDescriptorSetLayout createUniformLayouts(std::vector<VkDescriptorType> types, int amountInVertexShader);
-    GraphicsPipeline createGraphicPipeline(VkDescriptorSetLayout layout, std::string shaderName);
+    PipelineDescription describePipeline(VkDescriptorSetLayout layout, std::string shaderName, VertexInput vertexInput = SpriteVertex::Layout::input());
+    GraphicsPipeline createGraphicPipeline(VkDescriptorSetLayout layout, std::string shaderName, VertexInput vertexInput = SpriteVertex::Layout::input());
+    GraphicsPipeline createGraphicPipeline(PipelineDescription description);
+    PipelineHandle compileGraphicPipeline(VkDescriptorSetLayout layout, std::string shaderName, VertexInput vertexInput = SpriteVertex::Layout::input());
+    PipelineHandle compileGraphicPipeline(PipelineDescription description);
+    VkDescriptorSetLayout createComputeLayout(std::vector<VkDescriptorType> types);
+    ComputePipeline createComputePipeline(VkDescriptorSetLayout layout, std::string shaderName, uint32_t pushConstantSize = 0);
+    VkDescriptorSet allocateDescriptorSet(VkDescriptorSetLayout layout);
+    Buffer createStorageBuffer(VkDeviceSize size, VkBufferUsageFlags usage);
+    Texture createStorageImage(uint32_t width, uint32_t height, VkFormat format);
+    void dispatch(ComputeDispatch dispatch);
+    void runCompute(const std::vector<ComputeDispatch> &dispatches);
+    CullingBatch createCullingBatch(std::vector<CullObject> objects, std::vector<Buffer> uniformBuffers);
+    DrawCommand cullDraw(CullingBatch &batch, GraphicsPipeline pipeline, Buffer vertexBuffer, Buffer indexBuffer, VkDescriptorSet descriptorSet);
+    GraphicsPipeline createOcclusionProxyPipeline(VkDescriptorSetLayout layout);
     Texture createTexture(std::string name);
+    Texture createTexture(AssetPack &pack, std::string name);
+    AssetPack openAssetPack(std::string path);
+    VkSampler createSampler();
+    VkSampler createSampler(const VkSamplerCreateInfo &info);
+    Texture createCompressedTexture(std::string fileName);
+    uint32_t streamTexture(std::string name);
+    TextureAtlas createTextureAtlas(uint32_t pageSize = 2048, uint32_t padding = 2);
+    SpriteBatch createSpriteBatch();
+    GraphicsPipeline createSpritePipeline();
+    void beginSprites(SpriteBatch &batch, const glm::mat3 &projection);
+    SceneTransforms createSceneTransforms(uint32_t capacity);
+    void updateSceneTransforms(SceneTransforms &scene);
+    Uniforms createSceneUniforms(SceneTransforms &scene, Texture texture, VkSampler sampler);
     Uniforms createUniforms(std::vector<VkDescriptorType> types, int amountInVertexShader, Texture texture, VkSampler sampler);
     std::vector<Buffer> createUniformBuffers(int amount);
-    Buffer createVBO(std::vector<Vertex> vertices);
+    VkDescriptorSet allocateFrameDescriptorSet(VkDescriptorSetLayout layout);
+    Buffer createVBO(const void *vertices, VkDeviceSize stride, size_t amountVertices);
+    template <typename V>
+    Buffer createVBO(const std::vector<V> &vertices)
+    {
+        return createVBO(vertices.data(), sizeof(V), vertices.size());
+    }
     Buffer createIndexBuffer(std::vector<uint16_t> indices);
-    void drawFrame(std::vector<Buffer> vertices, std::vector<Buffer> indices, GraphicsPipeline graphicsPipeline);
+    Buffer createIndexBuffer(std::vector<uint32_t> indices);
+    Buffer createIndexBuffer(const void *indices, size_t amountIndices, VkIndexType indexType);
+    Mesh createMesh(std::string path, uint32_t amountLods = 0);
+    std::vector<DrawCommand> visibleDraws(const SpatialIndex &index, const glm::mat4 &viewProjection, const std::vector<DrawCommand> &draws);
+    uint32_t selectLod(DrawCommand &draw, uint32_t object, const Mesh &mesh, const glm::mat4 &modelView, const glm::mat4 &projection);
+    void drawFrame(const std::vector<DrawCommand> &draws);
+    void drawFrame(std::vector<Buffer> vertices, std::vector<Buffer> indices, GraphicsPipeline graphicsPipeline, std::vector<uint32_t> nodes = {});
+    void drawFrame(std::vector<Buffer> vertices, std::vector<Buffer> indices, PipelineHandle &pipeline, GraphicsPipeline fallback, std::vector<uint32_t> nodes = {});
     void destroySampler(VkSampler sampler);
     void destroyTexture(Texture texture);
     void destroyPipeline(GraphicsPipeline pipeline);
+    void destroyPipeline(PipelineHandle pipeline);
+    void destroyPipeline(ComputePipeline pipeline);
     void destroyUniforms(Uniforms uniforms);
+    void destroyCullingBatch(CullingBatch batch);
     void destroyBuffer(Buffer buffer);
+    void destroyMesh(Mesh mesh);
+    void destroySpriteBatch(SpriteBatch &batch);
+    void destroySceneTransforms(SceneTransforms &scene);
     void listExtensionProperties();
 };
 